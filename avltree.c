@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 /**
  * avl_set_parent() - Set parent of node
@@ -17,10 +18,46 @@
 static void avl_set_parent(struct avl_node *node, struct avl_node *parent)
 {
 #ifndef AVL_PARENT_BALANCE_COMBINATION
-	node->parent = parent;
+	avl_store_node(&node->parent, parent);
 #else
-	node->parent_balance = (unsigned long)parent |
-			       (node->parent_balance & (uintptr_t)3);
+	uintptr_t parent_balance = (uintptr_t)parent |
+				   (node->parent_balance & (uintptr_t)3);
+
+#if defined(AVLTREE_ATOMIC_LINKS)
+	__atomic_store_n(&node->parent_balance, parent_balance,
+			 __ATOMIC_RELEASE);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	*(volatile uintptr_t *)&node->parent_balance = parent_balance;
+#else
+	node->parent_balance = parent_balance;
+#endif
+#endif
+}
+
+/**
+ * avl_load_parent() - Get parent of node for concurrent readers
+ * @node: pointer to the avl node
+ *
+ * Return: avl parent node of @node as stored by avl_set_parent or
+ *  avl_set_parent_balance
+ */
+static struct avl_node *avl_load_parent(struct avl_node *node)
+{
+#ifndef AVL_PARENT_BALANCE_COMBINATION
+	return avl_load_node(&node->parent);
+#else
+	uintptr_t parent_balance;
+
+#if defined(AVLTREE_ATOMIC_LINKS)
+	parent_balance = __atomic_load_n(&node->parent_balance,
+					 __ATOMIC_CONSUME);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	parent_balance = *(volatile uintptr_t *)&node->parent_balance;
+#else
+	parent_balance = node->parent_balance;
+#endif
+
+	return (struct avl_node *)(parent_balance & ~(uintptr_t)3);
 #endif
 }
 
@@ -35,7 +72,18 @@ static void avl_set_balance(struct avl_node *node,
 #ifndef AVL_PARENT_BALANCE_COMBINATION
 	node->balance = balance;
 #else
-	node->parent_balance = (node->parent_balance & ~(uintptr_t)3) | balance;
+	uintptr_t parent_balance = (node->parent_balance & ~(uintptr_t)3) |
+				   balance;
+
+	/* the parent pointer in the same word is loaded by lockless readers */
+#if defined(AVLTREE_ATOMIC_LINKS)
+	__atomic_store_n(&node->parent_balance, parent_balance,
+			 __ATOMIC_RELAXED);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	*(volatile uintptr_t *)&node->parent_balance = parent_balance;
+#else
+	node->parent_balance = parent_balance;
+#endif
 #endif
 }
 
@@ -50,6 +98,10 @@ static void avl_set_balance(struct avl_node *node,
  * as as new root. These entries are then updated to point to @new_node.
  *
  * @old_node and @root must not be NULL.
+ *
+ * The store of @new_node is ordered after all previous modifications. A
+ * rotated or replaced subtree is therefore completely linked before it becomes
+ * visible to a concurrent reader of an avl_root_seq.
  */
 static void avl_change_child(struct avl_node *old_node,
 			     struct avl_node *new_node,
@@ -57,11 +109,11 @@ static void avl_change_child(struct avl_node *old_node,
 {
 	if (parent) {
 		if (parent->left == old_node)
-			parent->left = new_node;
+			avl_store_node(&parent->left, new_node);
 		else
-			parent->right = new_node;
+			avl_store_node(&parent->right, new_node);
 	} else {
-		root->node = new_node;
+		avl_store_node(&root->node, new_node);
 	}
 }
 
@@ -73,19 +125,25 @@ static void avl_change_child(struct avl_node *old_node,
  * @root: pointer to avl root
  * @balance_top: new balance for @node_top
  * @balance_child: new balance for @node_child
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
  * @node_top must have been a valid child of @node_child. The child changes
  * for the rotation in @node_child and @node_top must already be finished.
  * The switch of parents for @node_top, @node_child and @node_child2
  * (when it exists) is peformend. The change of the child entry of the new
  * parent of @node_top is done afterwards.
+ *
+ * The rotate functions must first unlink @node_child2 from @node_top and only
+ * then add the link from @node_top to @node_child. A concurrent reader can then
+ * only miss nodes during the rotation but never runs into a cycle.
  */
 static void avl_rotate_switch_parents(struct avl_node *node_top,
 				      struct avl_node *node_child,
 				      struct avl_node *node_child2,
 				      struct avl_root *root,
 				      enum avl_node_balance balance_top,
-				      enum avl_node_balance balance_child)
+				      enum avl_node_balance balance_child,
+				      avl_augment_t augment)
 {
 	/* switch parents and set new balance */
 	avl_set_parent_balance(node_top, avl_parent(node_child), balance_top);
@@ -97,6 +155,12 @@ static void avl_rotate_switch_parents(struct avl_node *node_top,
 
 	/* parent of node_top must get its child pointer get fixed */
 	avl_change_child(node_child, node_top, avl_parent(node_top), root);
+
+	/* node_child is now below node_top and must be recalculated first */
+	if (augment) {
+		augment(node_child);
+		augment(node_top);
+	}
 }
 
 /**
@@ -124,6 +188,7 @@ static bool avl_is_right_child(struct avl_node *node)
  * @node: right node of @parent which moves balance to the right
  * @parent: root of the subtree to rotate to the left
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
  * The subtree under @node is rotated to the right and the subtree under @parent
  * is rotated to the left to avoid that the balance of @parent becomes double
@@ -136,15 +201,16 @@ static bool avl_is_right_child(struct avl_node *node)
  */
 static struct avl_node *avl_rotate_rightleft(struct avl_node *node,
 					     struct avl_node *parent,
-					     struct avl_root *root)
+					     struct avl_root *root,
+					     avl_augment_t augment)
 {
 	enum avl_node_balance balance_parent, balance_node;
 	struct avl_node *tmp;
 
 	/* rotate right */
 	tmp = node->left;
-	node->left = tmp->right;
-	tmp->right = node;
+	avl_store_node(&node->left, tmp->right);
+	avl_store_node(&tmp->right, node);
 
 	switch (avl_balance(tmp)) {
 	default:
@@ -160,18 +226,24 @@ static struct avl_node *avl_rotate_rightleft(struct avl_node *node,
 		balance_parent = AVL_NEUTRAL;
 		balance_node = AVL_RIGHT;
 		break;
+#ifdef AVLTREE_WAVL
+	case AVL_WEAK:
+		balance_parent = AVL_LEFT;
+		balance_node = AVL_RIGHT;
+		break;
+#endif
 	}
 
 	avl_rotate_switch_parents(tmp, node, node->left, root, AVL_NEUTRAL,
-				  balance_node);
+				  balance_node, augment);
 
 	/* rotate left */
 	tmp = parent->right;
-	parent->right = tmp->left;
-	tmp->left = parent;
+	avl_store_node(&parent->right, tmp->left);
+	avl_store_node(&tmp->left, parent);
 
 	avl_rotate_switch_parents(tmp, parent, parent->right, root, AVL_NEUTRAL,
-				  balance_parent);
+				  balance_parent, augment);
 
 	return tmp;
 }
@@ -181,6 +253,7 @@ static struct avl_node *avl_rotate_rightleft(struct avl_node *node,
  * @node: left node of @parent which moves balance to the left
  * @parent: root of the subtree to rotate to the right
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
  * The subtree under @node is rotated to the left and the subtree under @parent
  * is rotated to the right to avoid that the balance of @parent becomes double
@@ -193,15 +266,16 @@ static struct avl_node *avl_rotate_rightleft(struct avl_node *node,
  */
 static struct avl_node *avl_rotate_leftright(struct avl_node *node,
 					     struct avl_node *parent,
-					     struct avl_root *root)
+					     struct avl_root *root,
+					     avl_augment_t augment)
 {
 	enum avl_node_balance balance_parent, balance_node;
 	struct avl_node *tmp;
 
 	/* rotate left */
 	tmp = node->right;
-	node->right = tmp->left;
-	tmp->left = node;
+	avl_store_node(&node->right, tmp->left);
+	avl_store_node(&tmp->left, node);
 
 	switch (avl_balance(tmp)) {
 	default:
@@ -217,18 +291,24 @@ static struct avl_node *avl_rotate_leftright(struct avl_node *node,
 		balance_parent = AVL_RIGHT;
 		balance_node = AVL_NEUTRAL;
 		break;
+#ifdef AVLTREE_WAVL
+	case AVL_WEAK:
+		balance_parent = AVL_RIGHT;
+		balance_node = AVL_LEFT;
+		break;
+#endif
 	}
 
 	avl_rotate_switch_parents(tmp, node, node->right, root, AVL_NEUTRAL,
-				  balance_node);
+				  balance_node, augment);
 
 	/* rotate right */
 	tmp = parent->left;
-	parent->left = tmp->right;
-	tmp->right = parent;
+	avl_store_node(&parent->left, tmp->right);
+	avl_store_node(&tmp->right, parent);
 
 	avl_rotate_switch_parents(tmp, parent, parent->left, root, AVL_NEUTRAL,
-				  balance_parent);
+				  balance_parent, augment);
 
 	return tmp;
 }
@@ -238,6 +318,7 @@ static struct avl_node *avl_rotate_leftright(struct avl_node *node,
  * @node: right node of @parent which moves balance to the right
  * @parent: root of the subtree to rotate to the left
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
  * The subtree under @parent is rotated to the right to avoid that the balance
  * of @parent becomes double right.
@@ -250,7 +331,8 @@ static struct avl_node *avl_rotate_leftright(struct avl_node *node,
  */
 static struct avl_node *avl_rotate_left(struct avl_node *node,
 					struct avl_node *parent,
-					struct avl_root *root)
+					struct avl_root *root,
+					avl_augment_t augment)
 {
 	enum avl_node_balance balance_parent, balance_node;
 	struct avl_node *tmp;
@@ -270,11 +352,11 @@ static struct avl_node *avl_rotate_left(struct avl_node *node,
 
 	/* rotate left */
 	tmp = parent->right;
-	parent->right = tmp->left;
-	tmp->left = parent;
+	avl_store_node(&parent->right, tmp->left);
+	avl_store_node(&tmp->left, parent);
 
 	avl_rotate_switch_parents(tmp, parent, parent->right,
-				  root, balance_node, balance_parent);
+				  root, balance_node, balance_parent, augment);
 
 	return tmp;
 }
@@ -284,6 +366,7 @@ static struct avl_node *avl_rotate_left(struct avl_node *node,
  * @node: left node of @parent which moves balance to the left
  * @parent: root of the subtree to rotate to the right
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
  * The subtree under @parent is rotated to the left to avoid that the balance of
  * @parent becomes double left.
@@ -296,7 +379,8 @@ static struct avl_node *avl_rotate_left(struct avl_node *node,
  */
 static struct avl_node *avl_rotate_right(struct avl_node *node,
 					 struct avl_node *parent,
-					 struct avl_root *root)
+					 struct avl_root *root,
+					 avl_augment_t augment)
 {
 	enum avl_node_balance balance_parent, balance_node;
 	struct avl_node *tmp;
@@ -316,106 +400,147 @@ static struct avl_node *avl_rotate_right(struct avl_node *node,
 
 	/* rotate right */
 	tmp = parent->left;
-	parent->left = tmp->right;
-	tmp->right = parent;
+	avl_store_node(&parent->left, tmp->right);
+	avl_store_node(&tmp->right, parent);
 
 	avl_rotate_switch_parents(tmp, parent, parent->left, root, balance_node,
-				  balance_parent);
+				  balance_parent, augment);
 
 	return tmp;
 }
 
 /**
- * avl_insert_balance() - Go tree upwards and rebalance it after insert
- * @node: pointer to the new node
+ * avl_insert_step() - Fix parent after growth of one of its children
+ * @node: pointer to the node whose subtree height increased by one
+ * @parent: parent of @node
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
- * The tree is traversed from bottom to the top starting at @node. The relative
- * height of each node will be adjusted on the path upwards. Rotations are used
- * to fix nodes which would become double left or double right leaning.
- *
- * When the tree was an AVL tree before the link of the new node then the
- * resulting tree will again be an AVL tree
+ * Return: true when the height of the subtree of @parent increased too
  */
-void avl_insert_balance(struct avl_node *node, struct avl_root *root)
+static bool avl_insert_step(struct avl_node *node, struct avl_node *parent,
+			    struct avl_root *root, avl_augment_t augment)
 {
-	struct avl_node *parent;
-
-	/* go tree upwards and fix the nodes on the way */
-	while ((parent = avl_parent(node))) {
-		if (avl_is_right_child(node)) {
-			switch (avl_balance(parent)) {
+	if (avl_is_right_child(node)) {
+		switch (avl_balance(parent)) {
+		default:
+		case AVL_RIGHT:
+			/* compensate double right balance by rotation
+			 * and stop afterwards
+			 */
+			switch (avl_balance(node)) {
 			default:
 			case AVL_RIGHT:
-				/* compensate double right balance by rotation
-				 * and stop afterwards
-				 */
-				switch (avl_balance(node)) {
-				default:
-				case AVL_RIGHT:
-				case AVL_NEUTRAL:
-					avl_rotate_left(node, parent, root);
-					break;
-				case AVL_LEFT:
-					avl_rotate_rightleft(node, parent,
-							     root);
-					break;
-				}
-
-				parent = NULL;
-				break;
 			case AVL_NEUTRAL:
-				/* mark balance as right and continue upwards */
-				avl_set_balance(parent, AVL_RIGHT);
+				avl_rotate_left(node, parent, root, augment);
 				break;
 			case AVL_LEFT:
-				/* new right child + left leaning == balanced
-				 * nothing to propagate upwards after that
-				 */
-				avl_set_balance(parent, AVL_NEUTRAL);
-				parent = NULL;
+				avl_rotate_rightleft(node, parent, root,
+						     augment);
 				break;
 			}
-		} else {
-			switch (avl_balance(parent)) {
+
+			return false;
+		case AVL_NEUTRAL:
+			/* mark balance as right and continue upwards */
+			avl_set_balance(parent, AVL_RIGHT);
+			break;
+		case AVL_LEFT:
+			/* new right child + left leaning == balanced
+			 * nothing to propagate upwards after that
+			 */
+			avl_set_balance(parent, AVL_NEUTRAL);
+			return false;
+#ifdef AVLTREE_WAVL
+		case AVL_WEAK:
+			/* right child is no longer a 2-child */
+			avl_set_balance(parent, AVL_RIGHT);
+			return false;
+#endif
+		}
+	} else {
+		switch (avl_balance(parent)) {
+		default:
+		case AVL_RIGHT:
+			/* new left child + right leaning == balanced
+			 * nothing to propagate upwards after that
+			 */
+			avl_set_balance(parent, AVL_NEUTRAL);
+			return false;
+#ifdef AVLTREE_WAVL
+		case AVL_WEAK:
+			/* left child is no longer a 2-child */
+			avl_set_balance(parent, AVL_LEFT);
+			return false;
+#endif
+		case AVL_NEUTRAL:
+			/* mark balance as left and continue upwards */
+			avl_set_balance(parent, AVL_LEFT);
+			break;
+		case AVL_LEFT:
+			/* compensate double left balance by rotation
+			 * and stop afterwards
+			 */
+			switch (avl_balance(node)) {
 			default:
-			case AVL_RIGHT:
-				/* new left child + right leaning == balanced
-				 * nothing to propagate upwards after that
-				 */
-				avl_set_balance(parent, AVL_NEUTRAL);
-				parent = NULL;
-				break;
+			case AVL_LEFT:
 			case AVL_NEUTRAL:
-				/* mark balance as left and continue upwards */
-				avl_set_balance(parent, AVL_LEFT);
+				avl_rotate_right(node, parent, root, augment);
 				break;
-			case AVL_LEFT:
-				/* compensate double left balance by rotation
-				 * and stop afterwards
-				 */
-				switch (avl_balance(node)) {
-				default:
-				case AVL_LEFT:
-				case AVL_NEUTRAL:
-					avl_rotate_right(node, parent, root);
-					break;
-				case AVL_RIGHT:
-					avl_rotate_leftright(node, parent,
-							     root);
-					break;
-				}
-
-				parent = NULL;
+			case AVL_RIGHT:
+				avl_rotate_leftright(node, parent, root,
+						     augment);
 				break;
 			}
+
+			return false;
 		}
+	}
 
-		if (!parent)
-			break;
+	return true;
+}
+
+/**
+ * avl_insert_rebalance() - Go tree upwards and rebalance it after growth
+ * @node: pointer to the node whose subtree height increased by one
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
+ *
+ * The balance of @node must already be correct. Only its parents are adjusted.
+ *
+ * Return: true when the height of the whole tree increased, false otherwise
+ */
+static bool avl_insert_rebalance(struct avl_node *node, struct avl_root *root,
+				 avl_augment_t augment)
+{
+	struct avl_node *parent;
+
+	/* go tree upwards and fix the nodes on the way */
+	while ((parent = avl_parent(node))) {
+		if (!avl_insert_step(node, parent, root, augment))
+			return false;
 
 		node = parent;
 	}
+
+	return true;
+}
+
+/**
+ * avl_insert_balance() - Go tree upwards and rebalance it after insert
+ * @node: pointer to the new node
+ * @root: pointer to avl root
+ *
+ * The tree is traversed from bottom to the top starting at @node. The relative
+ * height of each node will be adjusted on the path upwards. Rotations are used
+ * to fix nodes which would become double left or double right leaning.
+ *
+ * When the tree was an AVL tree before the link of the new node then the
+ * resulting tree will again be an AVL tree
+ */
+void avl_insert_balance(struct avl_node *node, struct avl_root *root)
+{
+	avl_insert_rebalance(node, root, NULL);
 }
 
 /**
@@ -487,7 +612,11 @@ struct avl_node *avl_erase_node(struct avl_node *node, struct avl_root *root,
 		*removed_right = avl_is_right_child(smallest);
 	}
 
-	/* move right child of smallest one up */
+	/* move right child of smallest one up
+	 *
+	 * smallest must be unlinked before it gets the children of node.
+	 * Otherwise a concurrent reader could run into a cycle
+	 */
 	if (smallest->right)
 		avl_set_parent(smallest->right, smallest_parent);
 	avl_change_child(smallest, smallest->right, smallest_parent, root);
@@ -495,10 +624,10 @@ struct avl_node *avl_erase_node(struct avl_node *node, struct avl_root *root,
 	/* exchange node with smallest */
 	avl_set_parent_balance(smallest, avl_parent(node), avl_balance(node));
 
-	smallest->left = node->left;
+	avl_store_node(&smallest->left, node->left);
 	avl_set_parent(smallest->left, smallest);
 
-	smallest->right = node->right;
+	avl_store_node(&smallest->right, node->right);
 	if (smallest->right)
 		avl_set_parent(smallest->right, smallest);
 
@@ -507,117 +636,316 @@ struct avl_node *avl_erase_node(struct avl_node *node, struct avl_root *root,
 	return decreased_node;
 }
 
+#ifdef AVLTREE_WAVL
 /**
- * avl_erase_balance() - Go tree upwards and rebalance it after erase_node
+ * avl_erase_rotate() - Fix 3-child of node by rotations
+ * @parent: node with a child whose rank is three lower
+ * @removed_right: whether the 3-child is the right child of @parent
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
+ *
+ * The sibling of the 3-child must be a 1-child which is not a 2,2 node. A
+ * single or double rotation restores the rank rule and the rank of the
+ * subtree doesn't change. Nothing has to be propagated upwards.
+ */
+static void avl_erase_rotate(struct avl_node *parent, bool removed_right,
+			     struct avl_root *root, avl_augment_t augment)
+{
+	enum avl_node_balance balance_sibling;
+	enum avl_node_balance balance_inner;
+	struct avl_node *sibling;
+	struct avl_node *inner;
+
+	if (!removed_right) {
+		sibling = parent->right;
+		balance_sibling = avl_balance(sibling);
+
+		if (balance_sibling != AVL_LEFT) {
+			/* outer child of sibling is a 1-child */
+			avl_rotate_left(sibling, parent, root, augment);
+
+			if (!parent->left && !parent->right) {
+				/* demote parent twice, it became a leaf */
+				avl_set_balance(parent, AVL_NEUTRAL);
+				avl_set_balance(sibling, AVL_WEAK);
+			} else if (balance_sibling & AVL_RIGHT) {
+				avl_set_balance(parent, AVL_WEAK);
+				avl_set_balance(sibling, AVL_LEFT);
+			} else {
+				avl_set_balance(parent, AVL_RIGHT);
+				avl_set_balance(sibling, AVL_LEFT);
+			}
+		} else {
+			/* outer child of sibling is a 2-child */
+			inner = sibling->left;
+			balance_inner = avl_balance(inner);
+			avl_rotate_rightleft(sibling, parent, root, augment);
+
+			if (balance_inner & AVL_RIGHT)
+				avl_set_balance(parent, AVL_LEFT);
+			else
+				avl_set_balance(parent, AVL_NEUTRAL);
+
+			if (balance_inner & AVL_LEFT)
+				avl_set_balance(sibling, AVL_RIGHT);
+			else
+				avl_set_balance(sibling, AVL_NEUTRAL);
+
+			avl_set_balance(inner, AVL_WEAK);
+		}
+	} else {
+		sibling = parent->left;
+		balance_sibling = avl_balance(sibling);
+
+		if (balance_sibling != AVL_RIGHT) {
+			/* outer child of sibling is a 1-child */
+			avl_rotate_right(sibling, parent, root, augment);
+
+			if (!parent->left && !parent->right) {
+				/* demote parent twice, it became a leaf */
+				avl_set_balance(parent, AVL_NEUTRAL);
+				avl_set_balance(sibling, AVL_WEAK);
+			} else if (balance_sibling & AVL_LEFT) {
+				avl_set_balance(parent, AVL_WEAK);
+				avl_set_balance(sibling, AVL_RIGHT);
+			} else {
+				avl_set_balance(parent, AVL_LEFT);
+				avl_set_balance(sibling, AVL_RIGHT);
+			}
+		} else {
+			/* outer child of sibling is a 2-child */
+			inner = sibling->right;
+			balance_inner = avl_balance(inner);
+			avl_rotate_leftright(sibling, parent, root, augment);
+
+			if (balance_inner & AVL_LEFT)
+				avl_set_balance(parent, AVL_RIGHT);
+			else
+				avl_set_balance(parent, AVL_NEUTRAL);
+
+			if (balance_inner & AVL_RIGHT)
+				avl_set_balance(sibling, AVL_LEFT);
+			else
+				avl_set_balance(sibling, AVL_NEUTRAL);
+
+			avl_set_balance(inner, AVL_WEAK);
+		}
+	}
+}
+
+/**
+ * avl_erase_step() - Fix node after its child subtree lost one rank
  * @parent: node whose child was removed
- * @removed_right: returns whether @parent now has a decreased depth under
- *  the right child
+ * @removed_right: whether @parent now has a decreased rank under the right
+ *  child
  * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
  *
- * The tree is traversed from bottom to the top starting at @parent. The
- * relative height of each node will be adjusted on the path upwards. Rotations
- * are used to fix nodes which would become double left or double right leaning.
+ * Nodes are only demoted. At most two rotations are used and they always
+ * stop the traversal.
  *
- * When the tree was an AVL-tree before the erase of the node then the resulting
- * tree will again be an AVL-tree
+ * Return: node whose subtree now has a decreased rank, NULL if nothing has to
+ *  be propagated upwards
  */
-void avl_erase_balance(struct avl_node *parent, bool removed_right,
-		       struct avl_root *root)
+static struct avl_node *avl_erase_step(struct avl_node *parent,
+				       bool removed_right,
+				       struct avl_root *root,
+				       avl_augment_t augment)
+{
+	enum avl_node_balance balance_removed;
+	enum avl_node_balance balance_sibling;
+	enum avl_node_balance balance;
+	struct avl_node *sibling;
+
+	/* balance flag marking the removed/sibling side as 2-child */
+	if (removed_right) {
+		balance_removed = AVL_LEFT;
+		balance_sibling = AVL_RIGHT;
+		sibling = parent->left;
+	} else {
+		balance_removed = AVL_RIGHT;
+		balance_sibling = AVL_LEFT;
+		sibling = parent->right;
+	}
+
+	balance = avl_balance(parent);
+	if (balance == AVL_NEUTRAL) {
+		/* 1,1 node: removed side becomes 2-child */
+		avl_set_balance(parent, balance_removed);
+		return NULL;
+	} else if (balance == balance_sibling) {
+		/* 1,2 node becomes 2,2 node. Only a leaf has to be
+		 * demoted
+		 */
+		if (parent->left || parent->right) {
+			avl_set_balance(parent, AVL_WEAK);
+			return NULL;
+		}
+
+		avl_set_balance(parent, AVL_NEUTRAL);
+	} else if (balance == AVL_WEAK) {
+		/* 3-child and 2-child: demote parent */
+		avl_set_balance(parent, balance_removed);
+	} else if (avl_balance(sibling) == AVL_WEAK) {
+		/* 3-child and 2,2 sibling: demote both */
+		avl_set_balance(sibling, AVL_NEUTRAL);
+		avl_set_balance(parent, balance_removed);
+	} else {
+		avl_erase_rotate(parent, removed_right, root, augment);
+		return NULL;
+	}
+
+	return parent;
+}
+#else
+/**
+ * avl_erase_step() - Fix node after its child subtree lost one level
+ * @parent: node whose child was removed
+ * @removed_right: whether @parent now has a decreased depth under the right
+ *  child
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
+ *
+ * Return: root of the subtree (@parent or the node rotated in its place) which
+ *  now has a decreased depth, NULL if nothing has to be propagated upwards
+ */
+static struct avl_node *avl_erase_step(struct avl_node *parent,
+				       bool removed_right,
+				       struct avl_root *root,
+				       avl_augment_t augment)
 {
 	struct avl_node *node;
 
-	/* go tree upwards and fix the nodes on the way */
-	while (parent) {
-		if (!removed_right) {
-			switch (avl_balance(parent)) {
-			case AVL_RIGHT:
+	if (!removed_right) {
+		switch (avl_balance(parent)) {
+		case AVL_RIGHT:
+		default:
+			/* compensate double right balance using
+			 * rotations
+			 */
+			node = parent->right;
+			switch (avl_balance(node)) {
 			default:
-				/* compensate double right balance using
-				 * rotations
-				 */
-				node = parent->right;
-				switch (avl_balance(node)) {
-				default:
-				case AVL_RIGHT:
-					parent = avl_rotate_left(node, parent,
-								 root);
-					break;
-				case AVL_NEUTRAL:
-					avl_rotate_left(node, parent, root);
-					parent = NULL;
-					break;
-				case AVL_LEFT:
-					parent = avl_rotate_rightleft(node,
-								      parent,
-								      root);
-					break;
-				}
+			case AVL_RIGHT:
+				parent = avl_rotate_left(node, parent, root,
+								 augment);
 				break;
 			case AVL_NEUTRAL:
-				/* there must have been a right child when
-				 * the balance was neutral and the left child
-				 * got removed. It is therefore enough to
-				 * set balance to right and stop because the
-				 * height of subtree didn't change
-				 */
-				avl_set_balance(parent, AVL_RIGHT);
+				avl_rotate_left(node, parent, root, augment);
 				parent = NULL;
 				break;
 			case AVL_LEFT:
-				/* mark balance as neutral and continue */
-				avl_set_balance(parent, AVL_NEUTRAL);
+				parent = avl_rotate_rightleft(node, parent,
+							      root, augment);
 				break;
 			}
-		} else {
-			switch (avl_balance(parent)) {
-			default:
-			case AVL_RIGHT:
-				/* mark balance as neutral and continue */
-				avl_set_balance(parent, AVL_NEUTRAL);
+			break;
+		case AVL_NEUTRAL:
+			/* there must have been a right child when
+			 * the balance was neutral and the left child
+			 * got removed. It is therefore enough to
+			 * set balance to right and stop because the
+			 * height of subtree didn't change
+			 */
+			avl_set_balance(parent, AVL_RIGHT);
+			parent = NULL;
+			break;
+		case AVL_LEFT:
+			/* mark balance as neutral and continue */
+			avl_set_balance(parent, AVL_NEUTRAL);
+			break;
+		}
+	} else {
+		switch (avl_balance(parent)) {
+		default:
+		case AVL_RIGHT:
+			/* mark balance as neutral and continue */
+			avl_set_balance(parent, AVL_NEUTRAL);
+			break;
+		case AVL_NEUTRAL:
+			/* there must have been a left child when
+			 * the balance was neutral and the right child
+			 * got removed. It is therefore enough to
+			 * set balance to left and stop because the
+			 * height of subtree didn't change
+			 */
+			avl_set_balance(parent, AVL_LEFT);
+			parent = NULL;
+			break;
+		case AVL_LEFT:
+			/* compensate double left balance using
+			 * rotations
+			 */
+			node = parent->left;
+			switch (avl_balance(node)) {
+			case AVL_LEFT:
+				parent = avl_rotate_right(node, parent, root,
+								  augment);
 				break;
 			case AVL_NEUTRAL:
-				/* there must have been a left child when
-				 * the balance was neutral and the right child
-				 * got removed. It is therefore enough to
-				 * set balance to left and stop because the
-				 * height of subtree didn't change
-				 */
-				avl_set_balance(parent, AVL_LEFT);
+				avl_rotate_right(node, parent, root, augment);
 				parent = NULL;
 				break;
-			case AVL_LEFT:
-				/* compensate double left balance using
-				 * rotations
-				 */
-				node = parent->left;
-				switch (avl_balance(node)) {
-				case AVL_LEFT:
-					parent = avl_rotate_right(node, parent,
-								  root);
-					break;
-				case AVL_NEUTRAL:
-					avl_rotate_right(node, parent, root);
-					parent = NULL;
-					break;
-				default:
-				case AVL_RIGHT:
-					parent = avl_rotate_leftright(node,
-								      parent,
-								      root);
-					break;
-				}
+			default:
+			case AVL_RIGHT:
+				parent = avl_rotate_leftright(node, parent,
+							      root, augment);
 				break;
 			}
+			break;
 		}
+	}
+
+	return parent;
+}
+#endif
+
+/**
+ * avl_erase_rebalance() - Go tree upwards and rebalance it after erase
+ * @parent: node whose child was removed
+ * @removed_right: whether @parent now has a decreased depth under the right
+ *  child
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data, NULL when not augmented
+ */
+static void avl_erase_rebalance(struct avl_node *parent, bool removed_right,
+				struct avl_root *root, avl_augment_t augment)
+{
+	struct avl_node *node;
 
-		if (!parent)
+	/* go tree upwards and fix the nodes on the way */
+	while (parent) {
+		node = avl_erase_step(parent, removed_right, root, augment);
+		if (!node)
 			break;
 
-		removed_right = avl_is_right_child(parent);
-		parent = avl_parent(parent);
+		removed_right = avl_is_right_child(node);
+		parent = avl_parent(node);
 	}
 }
 
+/**
+ * avl_erase_balance() - Go tree upwards and rebalance it after erase_node
+ * @parent: node whose child was removed
+ * @removed_right: returns whether @parent now has a decreased depth under
+ *  the right child
+ * @root: pointer to avl root
+ *
+ * The tree is traversed from bottom to the top starting at @parent. The
+ * relative height of each node will be adjusted on the path upwards. Rotations
+ * are used to fix nodes which would become double left or double right leaning.
+ * In WAVL mode, nodes are only demoted and the traversal stops after at most
+ * two rotations.
+ *
+ * When the tree was an AVL-tree before the erase of the node then the resulting
+ * tree will again be an AVL-tree
+ */
+void avl_erase_balance(struct avl_node *parent, bool removed_right,
+		       struct avl_root *root)
+{
+	avl_erase_rebalance(parent, removed_right, root, NULL);
+}
+
 /**
  * avl_first() - Find leftmost avl node in tree
  * @root: pointer to avl root
@@ -626,14 +954,15 @@ void avl_erase_balance(struct avl_node *parent, bool removed_right,
  */
 struct avl_node *avl_first(const struct avl_root *root)
 {
-	struct avl_node *node = root->node;
+	struct avl_node *node = avl_load_node(&root->node);
+	struct avl_node *left;
 
 	if (!node)
 		return node;
 
 	/* descend down via smaller/preceding child */
-	while (node->left)
-		node = node->left;
+	while ((left = avl_load_node(&node->left)))
+		node = left;
 
 	return node;
 }
@@ -646,14 +975,15 @@ struct avl_node *avl_first(const struct avl_root *root)
  */
 struct avl_node *avl_last(const struct avl_root *root)
 {
-	struct avl_node *node = root->node;
+	struct avl_node *node = avl_load_node(&root->node);
+	struct avl_node *right;
 
 	if (!node)
 		return node;
 
 	/* descend down via larger/succeeding child */
-	while (node->right)
-		node = node->right;
+	while ((right = avl_load_node(&node->right)))
+		node = right;
 
 	return node;
 }
@@ -667,27 +997,29 @@ struct avl_node *avl_last(const struct avl_root *root)
 struct avl_node *avl_next(struct avl_node *node)
 {
 	struct avl_node *parent;
+	struct avl_node *child;
 
 	/* there is a right child - next node must be the leftmost under it */
-	if (node->right) {
-		node = node->right;
-		while (node->left)
-			node = node->left;
+	child = avl_load_node(&node->right);
+	if (child) {
+		node = child;
+		while ((child = avl_load_node(&node->left)))
+			node = child;
 
 		return node;
 	}
 
 	/* otherwise check if we have a parent (and thus maybe siblings) */
-	parent = avl_parent(node);
+	parent = avl_load_parent(node);
 	if (!parent)
 		return parent;
 
 	/* go up the tree until the path connecting both is the left child
 	 * pointer and therefore the parent is the next node
 	 */
-	while (parent && parent->right == node) {
+	while (parent && avl_load_node(&parent->right) == node) {
 		node = parent;
-		parent = avl_parent(node);
+		parent = avl_load_parent(node);
 	}
 
 	return parent;
@@ -702,28 +1034,2435 @@ struct avl_node *avl_next(struct avl_node *node)
 struct avl_node *avl_prev(struct avl_node *node)
 {
 	struct avl_node *parent;
+	struct avl_node *child;
 
 	/* there is a left child - prev node must be the rightmost under it */
-	if (node->left) {
-		node = node->left;
-		while (node->right)
-			node = node->right;
+	child = avl_load_node(&node->left);
+	if (child) {
+		node = child;
+		while ((child = avl_load_node(&node->right)))
+			node = child;
 
 		return node;
 	}
 
 	/* otherwise check if we have a parent (and thus maybe siblings) */
-	parent = avl_parent(node);
+	parent = avl_load_parent(node);
 	if (!parent)
 		return parent;
 
 	/* go up the tree until the path connecting both is the right child
 	 * pointer and therefore the parent is the prev node
 	 */
-	while (parent && parent->left == node) {
+	while (parent && avl_load_node(&parent->left) == node) {
 		node = parent;
-		parent = avl_parent(node);
+		parent = avl_load_parent(node);
 	}
 
 	return parent;
 }
+
+/**
+ * struct avl_subtree - detached subtree with known height
+ * @node: root node of the subtree, NULL for an empty subtree
+ * @height: height of the subtree, 0 for an empty subtree
+ */
+struct avl_subtree {
+	struct avl_node *node;
+	size_t height;
+};
+
+/**
+ * avl_height() - Calculate height of subtree
+ * @node: root node of the subtree
+ *
+ * Return: number of nodes on the longest path from @node to a leaf, rank + 1
+ *  when AVLTREE_WAVL is defined
+ */
+static size_t avl_height(const struct avl_node *node)
+{
+	size_t height = 0;
+
+	/* AVL_RIGHT marks a left child which is two levels lower */
+	while (node) {
+		if (avl_balance(node) & AVL_RIGHT)
+			height += 2;
+		else
+			height += 1;
+
+		node = node->left;
+	}
+
+	return height;
+}
+
+/**
+ * avl_subtree_child() - Get child subtree of node
+ * @node: parent of the child subtree
+ * @height: height of the subtree under @node
+ * @right: true to get the right child, false for the left child
+ *
+ * The parent pointer of the child is not modified.
+ *
+ * Return: child subtree with its height
+ */
+static struct avl_subtree avl_subtree_child(const struct avl_node *node,
+					    size_t height, bool right)
+{
+	struct avl_subtree child;
+
+	if (right) {
+		child.node = node->right;
+		if (avl_balance(node) & AVL_LEFT)
+			child.height = height - 2;
+		else
+			child.height = height - 1;
+	} else {
+		child.node = node->left;
+		if (avl_balance(node) & AVL_RIGHT)
+			child.height = height - 2;
+		else
+			child.height = height - 1;
+	}
+
+	return child;
+}
+
+/**
+ * avl_subtree_root() - Initialize subtree from root
+ * @root: pointer to avl root
+ *
+ * Return: subtree containing the whole tree of @root
+ */
+static struct avl_subtree avl_subtree_root(const struct avl_root *root)
+{
+	struct avl_subtree tree;
+
+	tree.node = root->node;
+	tree.height = avl_height(root->node);
+
+	return tree;
+}
+
+/**
+ * avl_join_augmented_subtree() - Join two subtrees with a middle node
+ * @left: subtree with all nodes smaller than @node
+ * @node: node which is not part of any tree
+ * @right: subtree with all nodes larger than @node
+ * @augment: function to recalculate augmented data, NULL when not augmented
+ *
+ * The higher subtree is descended along its inner spine until a subtree is
+ * found which is at most one level higher than the other subtree. @node
+ * replaces it and gets it and the lower subtree as children. The growth of
+ * this position is then rebalanced like an insert.
+ *
+ * Return: joined subtree
+ */
+static struct avl_subtree
+avl_join_augmented_subtree(struct avl_subtree left, struct avl_node *node,
+			   struct avl_subtree right, avl_augment_t augment)
+{
+	struct avl_subtree joined;
+	enum avl_node_balance balance;
+	struct avl_node *parent = NULL;
+	struct avl_subtree spine;
+	struct avl_root root;
+
+	if (left.height > right.height + 1) {
+		avl_set_parent(left.node, NULL);
+
+		spine = left;
+		while (spine.height > right.height + 1) {
+			parent = spine.node;
+			spine = avl_subtree_child(parent, spine.height, true);
+		}
+
+		if (spine.height > right.height)
+			balance = AVL_LEFT;
+		else
+			balance = AVL_NEUTRAL;
+
+		avl_set_parent_balance(node, parent, balance);
+		node->left = spine.node;
+		node->right = right.node;
+		if (spine.node)
+			avl_set_parent(spine.node, node);
+		if (right.node)
+			avl_set_parent(right.node, node);
+		avl_store_node(&parent->right, node);
+
+		if (augment)
+			avl_augment_propagate(node, augment);
+
+		root.node = left.node;
+		joined.height = left.height;
+		if (avl_insert_rebalance(node, &root, augment))
+			joined.height++;
+		joined.node = root.node;
+
+		return joined;
+	}
+
+	if (right.height > left.height + 1) {
+		avl_set_parent(right.node, NULL);
+
+		spine = right;
+		while (spine.height > left.height + 1) {
+			parent = spine.node;
+			spine = avl_subtree_child(parent, spine.height, false);
+		}
+
+		if (spine.height > left.height)
+			balance = AVL_RIGHT;
+		else
+			balance = AVL_NEUTRAL;
+
+		avl_set_parent_balance(node, parent, balance);
+		node->left = left.node;
+		node->right = spine.node;
+		if (left.node)
+			avl_set_parent(left.node, node);
+		if (spine.node)
+			avl_set_parent(spine.node, node);
+		avl_store_node(&parent->left, node);
+
+		if (augment)
+			avl_augment_propagate(node, augment);
+
+		root.node = right.node;
+		joined.height = right.height;
+		if (avl_insert_rebalance(node, &root, augment))
+			joined.height++;
+		joined.node = root.node;
+
+		return joined;
+	}
+
+	/* both subtrees are balanced enough to be direct children of node */
+	if (left.height > right.height) {
+		balance = AVL_LEFT;
+		joined.height = left.height + 1;
+	} else if (left.height < right.height) {
+		balance = AVL_RIGHT;
+		joined.height = right.height + 1;
+	} else {
+		balance = AVL_NEUTRAL;
+		joined.height = left.height + 1;
+	}
+
+	avl_set_parent_balance(node, NULL, balance);
+	node->left = left.node;
+	node->right = right.node;
+	if (left.node)
+		avl_set_parent(left.node, node);
+	if (right.node)
+		avl_set_parent(right.node, node);
+
+	if (augment)
+		augment(node);
+
+	joined.node = node;
+
+	return joined;
+}
+
+/**
+ * avl_join_subtree() - Join two subtrees with a middle node
+ * @left: subtree with all nodes smaller than @node
+ * @node: node which is not part of any tree
+ * @right: subtree with all nodes larger than @node
+ *
+ * Return: joined subtree
+ */
+static struct avl_subtree avl_join_subtree(struct avl_subtree left,
+					   struct avl_node *node,
+					   struct avl_subtree right)
+{
+	return avl_join_augmented_subtree(left, node, right, NULL);
+}
+
+/**
+ * avl_split_subtree() - Split subtree at key
+ * @tree: subtree to split
+ * @key: node with the key used for the split
+ * @cmp: compare function for the nodes
+ * @equal_left: move nodes equal to @key to @left instead of returning them
+ * @left: returns subtree with all nodes smaller than @key
+ * @right: returns subtree with all nodes larger than @key
+ *
+ * Return: node of @tree which is equal to @key, NULL if no such node exists
+ *  or @equal_left is true
+ */
+static struct avl_node *avl_split_subtree(struct avl_subtree tree,
+					  const struct avl_node *key,
+					  avl_cmp_t cmp, bool equal_left,
+					  struct avl_subtree *left,
+					  struct avl_subtree *right)
+{
+	struct avl_subtree child_left;
+	struct avl_subtree child_right;
+	struct avl_subtree part;
+	struct avl_node *found;
+	int res;
+
+	if (!tree.node) {
+		*left = tree;
+		*right = tree;
+		return NULL;
+	}
+
+	child_left = avl_subtree_child(tree.node, tree.height, false);
+	child_right = avl_subtree_child(tree.node, tree.height, true);
+
+	res = cmp(key, tree.node);
+	if (res == 0 && !equal_left) {
+		*left = child_left;
+		*right = child_right;
+		return tree.node;
+	}
+
+	if (res < 0) {
+		found = avl_split_subtree(child_left, key, cmp, equal_left,
+					  left, &part);
+		*right = avl_join_subtree(part, tree.node, child_right);
+	} else {
+		found = avl_split_subtree(child_right, key, cmp, equal_left,
+					  &part, right);
+		*left = avl_join_subtree(child_left, tree.node, part);
+	}
+
+	return found;
+}
+
+/**
+ * avl_split_last() - Remove largest node from subtree
+ * @tree: subtree with at least one node
+ * @rest: returns @tree without the largest node
+ *
+ * Return: largest node of @tree
+ */
+static struct avl_node *avl_split_last(struct avl_subtree tree,
+				       struct avl_subtree *rest)
+{
+	struct avl_subtree child_left;
+	struct avl_subtree child_right;
+	struct avl_subtree part;
+	struct avl_node *last;
+
+	child_left = avl_subtree_child(tree.node, tree.height, false);
+	child_right = avl_subtree_child(tree.node, tree.height, true);
+
+	if (!child_right.node) {
+		*rest = child_left;
+		return tree.node;
+	}
+
+	last = avl_split_last(child_right, &part);
+	*rest = avl_join_subtree(child_left, tree.node, part);
+
+	return last;
+}
+
+/**
+ * avl_join2_subtree() - Join two subtrees without middle node
+ * @left: subtree with all nodes smaller than the nodes in @right
+ * @right: subtree with all nodes larger than the nodes in @left
+ *
+ * Return: joined subtree
+ */
+static struct avl_subtree avl_join2_subtree(struct avl_subtree left,
+					    struct avl_subtree right)
+{
+	struct avl_subtree rest;
+	struct avl_node *last;
+
+	if (!left.node)
+		return right;
+
+	last = avl_split_last(left, &rest);
+
+	return avl_join_subtree(rest, last, right);
+}
+
+/**
+ * avl_drop_subtree() - Hand all nodes of subtree to drop function
+ * @node: root node of the subtree
+ * @drop: function receiving the removed nodes, can be NULL
+ */
+static void avl_drop_subtree(struct avl_node *node,
+			     void (*drop)(struct avl_node *node))
+{
+	struct avl_node *left;
+	struct avl_node *right;
+
+	if (!node || !drop)
+		return;
+
+	left = node->left;
+	right = node->right;
+
+	avl_drop_subtree(left, drop);
+	avl_drop_subtree(right, drop);
+	drop(node);
+}
+
+/**
+ * avl_subtree_to_root() - Store subtree as tree of root
+ * @root: pointer to avl root
+ * @tree: subtree which becomes the new tree of @root
+ */
+static void avl_subtree_to_root(struct avl_root *root, struct avl_subtree tree)
+{
+	if (tree.node)
+		avl_set_parent(tree.node, NULL);
+
+	avl_store_node(&root->node, tree.node);
+}
+
+/**
+ * avl_join() - Join two trees with a middle node
+ * @root: pointer to avl root which receives the joined tree
+ * @left: pointer to avl root with all nodes smaller than @node
+ * @node: node which is not part of any tree
+ * @right: pointer to avl root with all nodes larger than @node
+ *
+ * The nodes of @left, @node and the nodes of @right are moved to @root in
+ * O(log n). @left and @right are empty afterwards. @root can be the same as
+ * @left or @right.
+ */
+void avl_join(struct avl_root *root, struct avl_root *left,
+	      struct avl_node *node, struct avl_root *right)
+{
+	struct avl_subtree tree_left = avl_subtree_root(left);
+	struct avl_subtree tree_right = avl_subtree_root(right);
+	struct avl_subtree joined;
+
+	joined = avl_join_subtree(tree_left, node, tree_right);
+
+	INIT_AVL_ROOT(left);
+	INIT_AVL_ROOT(right);
+	avl_subtree_to_root(root, joined);
+}
+
+/**
+ * avl_split() - Split tree at key
+ * @root: pointer to avl root of the tree to split
+ * @key: node with the key used for the split, doesn't need to be in @root
+ * @cmp: compare function for the nodes
+ * @left: pointer to avl root which receives all nodes smaller than @key
+ * @right: pointer to avl root which receives all nodes larger than @key
+ *
+ * The nodes of @root are moved to @left and @right in O(log n). @root is empty
+ * afterwards. @root can be the same as @left or @right.
+ *
+ * Return: node of @root which is equal to @key and is no longer in any tree,
+ *  NULL if no such node exists
+ */
+struct avl_node *avl_split(struct avl_root *root, const struct avl_node *key,
+			   avl_cmp_t cmp, struct avl_root *left,
+			   struct avl_root *right)
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+	struct avl_subtree tree_left;
+	struct avl_subtree tree_right;
+	struct avl_node *found;
+
+	found = avl_split_subtree(tree, key, cmp, false, &tree_left,
+				  &tree_right);
+
+	INIT_AVL_ROOT(root);
+	avl_subtree_to_root(left, tree_left);
+	avl_subtree_to_root(right, tree_right);
+
+	return found;
+}
+
+/**
+ * avl_union_subtree() - Merge nodes of two subtrees
+ * @tree: subtree which keeps its nodes on duplicates
+ * @other: subtree whose duplicated nodes are dropped
+ * @cmp: compare function for the nodes
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * Return: subtree with the nodes of @tree and @other
+ */
+static struct avl_subtree
+avl_union_subtree(struct avl_subtree tree, struct avl_subtree other,
+		  avl_cmp_t cmp, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree other_left;
+	struct avl_subtree other_right;
+	struct avl_subtree left;
+	struct avl_subtree right;
+	struct avl_node *found;
+	struct avl_node *node;
+
+	if (!other.node)
+		return tree;
+
+	if (!tree.node)
+		return other;
+
+	node = other.node;
+	other_left = avl_subtree_child(node, other.height, false);
+	other_right = avl_subtree_child(node, other.height, true);
+
+	found = avl_split_subtree(tree, node, cmp, false, &left, &right);
+
+	/* both halves are independent and could be merged in parallel */
+	left = avl_union_subtree(left, other_left, cmp, drop);
+	right = avl_union_subtree(right, other_right, cmp, drop);
+
+	if (found) {
+		if (drop)
+			drop(node);
+		node = found;
+	}
+
+	return avl_join_subtree(left, node, right);
+}
+
+/**
+ * avl_union() - Move all nodes of other tree into tree
+ * @root: pointer to avl root which receives the nodes
+ * @other: pointer to avl root whose nodes are moved
+ * @cmp: compare function for the nodes
+ * @drop: function receiving nodes of @other which are equal to a node in
+ *  @root, can be NULL
+ *
+ * The trees are merged by recursively splitting @root at the nodes of @other
+ * and joining the merged halves. This requires O(m log(n/m + 1)) steps for m
+ * nodes in the smaller and n nodes in the larger tree. @other is empty
+ * afterwards.
+ */
+void avl_union(struct avl_root *root, struct avl_root *other, avl_cmp_t cmp,
+	       void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+	struct avl_subtree tree_other = avl_subtree_root(other);
+
+	INIT_AVL_ROOT(other);
+	tree = avl_union_subtree(tree, tree_other, cmp, drop);
+	avl_subtree_to_root(root, tree);
+}
+
+/**
+ * avl_intersect_subtree() - Keep nodes of subtree which are in other subtree
+ * @tree: subtree to filter
+ * @other: subtree with the nodes to keep, is not modified
+ * @cmp: compare function for the nodes
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * Return: subtree with the nodes of @tree which are equal to a node in @other
+ */
+static struct avl_subtree
+avl_intersect_subtree(struct avl_subtree tree, struct avl_subtree other,
+		      avl_cmp_t cmp, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree left;
+	struct avl_subtree right;
+	struct avl_node *found;
+
+	if (!tree.node)
+		return tree;
+
+	if (!other.node) {
+		avl_drop_subtree(tree.node, drop);
+		return other;
+	}
+
+	found = avl_split_subtree(tree, other.node, cmp, false, &left,
+				  &right);
+
+	left = avl_intersect_subtree(left,
+				     avl_subtree_child(other.node, other.height,
+						       false),
+				     cmp, drop);
+	right = avl_intersect_subtree(right,
+				      avl_subtree_child(other.node,
+							other.height, true),
+				      cmp, drop);
+
+	if (found)
+		return avl_join_subtree(left, found, right);
+	else
+		return avl_join2_subtree(left, right);
+}
+
+/**
+ * avl_intersect() - Remove all nodes of tree which are not in other tree
+ * @root: pointer to avl root to filter
+ * @other: pointer to avl root with the nodes to keep, is not modified. Can be
+ *  @root which keeps all nodes
+ * @cmp: compare function for the nodes
+ * @drop: function receiving the removed nodes of @root, can be NULL
+ *
+ * Requires O(m log(n/m + 1)) steps for m nodes in the smaller and n nodes in
+ * the larger tree.
+ */
+void avl_intersect(struct avl_root *root, const struct avl_root *other,
+		   avl_cmp_t cmp, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+	struct avl_subtree tree_other = avl_subtree_root(other);
+
+	/* every node is in other, no split and join is needed */
+	if (root == other)
+		return;
+
+	tree = avl_intersect_subtree(tree, tree_other, cmp, drop);
+	avl_subtree_to_root(root, tree);
+}
+
+/**
+ * avl_difference_subtree() - Remove nodes of subtree which are in other
+ * @tree: subtree to filter
+ * @other: subtree with the nodes to remove, is not modified
+ * @cmp: compare function for the nodes
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * Return: subtree with the nodes of @tree which are not equal to any node in
+ *  @other
+ */
+static struct avl_subtree
+avl_difference_subtree(struct avl_subtree tree, struct avl_subtree other,
+		       avl_cmp_t cmp, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree left;
+	struct avl_subtree right;
+	struct avl_node *found;
+
+	if (!tree.node || !other.node)
+		return tree;
+
+	found = avl_split_subtree(tree, other.node, cmp, false, &left,
+				  &right);
+	if (found && drop)
+		drop(found);
+
+	left = avl_difference_subtree(left,
+				      avl_subtree_child(other.node,
+							other.height, false),
+				      cmp, drop);
+	right = avl_difference_subtree(right,
+				       avl_subtree_child(other.node,
+							 other.height, true),
+				       cmp, drop);
+
+	return avl_join2_subtree(left, right);
+}
+
+/**
+ * avl_difference() - Remove all nodes of tree which are in other tree
+ * @root: pointer to avl root to filter
+ * @other: pointer to avl root with the nodes to remove, is not modified. Can
+ *  be @root which removes all nodes
+ * @cmp: compare function for the nodes
+ * @drop: function receiving the removed nodes of @root, can be NULL
+ *
+ * Requires O(m log(n/m + 1)) steps for m nodes in the smaller and n nodes in
+ * the larger tree.
+ */
+void avl_difference(struct avl_root *root, const struct avl_root *other,
+		    avl_cmp_t cmp, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+	struct avl_subtree tree_other = avl_subtree_root(other);
+
+	/* every node is in other, no split and join is needed */
+	if (root == other) {
+		avl_drop_subtree(root->node, drop);
+		INIT_AVL_ROOT(root);
+		return;
+	}
+
+	tree = avl_difference_subtree(tree, tree_other, cmp, drop);
+	avl_subtree_to_root(root, tree);
+}
+
+/**
+ * avl_partition() - Split tree into in-order ranges of similar size
+ * @root: pointer to avl root
+ * @parts: array which receives the ranges
+ * @nparts: maximum number of ranges in @parts
+ *
+ * The tree is not modified. The ranges are found by splitting repeatedly the
+ * range with the highest subtree at its root. The size of each range is
+ * estimated from the subtree height which is derived from the balance bits.
+ * Each returned range can be processed independently (e.g. on a different
+ * thread) by walking with avl_next from @first of the range until @first of
+ * the next range or NULL for the last range. More ranges than workers allow
+ * to compensate the remaining imbalance by letting idle workers take the next
+ * unprocessed range.
+ *
+ * Return: number of initialized ranges in @parts, at most @nparts
+ */
+size_t avl_partition(const struct avl_root *root, struct avl_range *parts,
+		     size_t nparts)
+{
+	struct avl_subtree subtree_left;
+	struct avl_subtree subtree_right;
+	struct avl_node *node;
+	size_t height;
+	size_t count;
+	size_t best;
+	size_t i;
+
+	if (!root->node || !nparts)
+		return 0;
+
+	parts[0].lead = NULL;
+	parts[0].subtree = root->node;
+	parts[0].height = avl_height(root->node);
+	count = 1;
+
+	while (count < nparts) {
+		/* split the (probably) largest range */
+		best = 0;
+		for (i = 1; i < count; i++) {
+			if (parts[i].height > parts[best].height)
+				best = i;
+		}
+
+		/* only ranges with at most two nodes are left */
+		if (parts[best].height < 2)
+			break;
+
+		node = parts[best].subtree;
+		height = parts[best].height;
+		subtree_left = avl_subtree_child(node, height, false);
+		subtree_right = avl_subtree_child(node, height, true);
+
+		/* (lead, left subtree), (node, right subtree) */
+		if (parts[best].lead || subtree_left.node) {
+			for (i = count; i > best + 1; i--)
+				parts[i] = parts[i - 1];
+
+			parts[best].subtree = subtree_left.node;
+			parts[best].height = subtree_left.height;
+			best++;
+			count++;
+		}
+
+		parts[best].lead = node;
+		parts[best].subtree = subtree_right.node;
+		parts[best].height = subtree_right.height;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (parts[i].lead) {
+			parts[i].first = parts[i].lead;
+			continue;
+		}
+
+		node = parts[i].subtree;
+		while (node->left)
+			node = node->left;
+
+		parts[i].first = node;
+	}
+
+	return count;
+}
+
+/**
+ * avl_build_balance() - Get balance of node in build subtree
+ * @n_left: number of nodes in the left half, equal or one more than @n_right
+ * @n_right: number of nodes in the right half
+ *
+ * Return: balance of node with @n_left nodes in left and @n_right nodes in right
+ *  subtree when both were build with the middle node as root
+ */
+static enum avl_node_balance avl_build_balance(size_t n_left, size_t n_right)
+{
+	/* the height of such a subtree with m nodes is the bit length of m */
+	if (n_left != n_right && (n_left & (n_left - 1)) == 0)
+		return AVL_LEFT;
+
+	return AVL_NEUTRAL;
+}
+
+/**
+ * avl_build_subtree() - Build balanced subtree from sorted node array
+ * @nodes: array with nodes sorted by their keys
+ * @n: number of nodes in @nodes
+ * @parent: parent node of the new subtree
+ *
+ * The middle node becomes the root of the subtree. The left half has the same
+ * number of nodes as the right half or one more. The balance can therefore be
+ * derived from the number of nodes in both halves.
+ *
+ * Return: root node of the subtree
+ */
+static struct avl_node *avl_build_subtree(struct avl_node **nodes, size_t n,
+					  struct avl_node *parent)
+{
+	struct avl_node *node;
+	size_t n_left;
+	size_t n_right;
+
+	if (!n)
+		return NULL;
+
+	n_left = n / 2;
+	n_right = n - n_left - 1;
+	node = nodes[n_left];
+
+	avl_set_parent_balance(node, parent, avl_build_balance(n_left, n_right));
+	node->left = avl_build_subtree(nodes, n_left, node);
+	node->right = avl_build_subtree(&nodes[n_left + 1], n_right, node);
+
+	return node;
+}
+
+/**
+ * avl_build_sorted() - Build tree from sorted node array
+ * @root: pointer to empty avl root
+ * @nodes: array with nodes sorted by their keys
+ * @n: number of nodes in @nodes
+ *
+ * The tree is build in O(n) without any rotation. The left and right half of
+ * @nodes are independent and can also be prepared (e.g. sorted) in parallel.
+ */
+void avl_build_sorted(struct avl_root *root, struct avl_node **nodes, size_t n)
+{
+	avl_store_node(&root->node, avl_build_subtree(nodes, n, NULL));
+}
+
+/**
+ * avl_sort_sift() - Move node down in heap until heap property is restored
+ * @nodes: array with heap of nodes
+ * @pos: position of the node to move down
+ * @n: number of nodes in the heap
+ * @cmp: compare function for the nodes
+ */
+static void avl_sort_sift(struct avl_node **nodes, size_t pos, size_t n,
+			  avl_cmp_t cmp)
+{
+	struct avl_node *tmp;
+	size_t child;
+
+	while ((child = 2 * pos + 1) < n) {
+		if (child + 1 < n && cmp(nodes[child], nodes[child + 1]) < 0)
+			child++;
+
+		if (cmp(nodes[pos], nodes[child]) >= 0)
+			break;
+
+		tmp = nodes[pos];
+		nodes[pos] = nodes[child];
+		nodes[child] = tmp;
+
+		pos = child;
+	}
+}
+
+/**
+ * avl_bulk_load() - Build tree from unsorted node array
+ * @root: pointer to empty avl root
+ * @nodes: array with nodes, gets sorted by their keys
+ * @n: number of nodes in @nodes
+ * @cmp: compare function for the nodes
+ *
+ * @nodes is sorted in place with heapsort (no additional memory required) and
+ * the tree is then build with avl_build_sorted.
+ */
+void avl_bulk_load(struct avl_root *root, struct avl_node **nodes, size_t n,
+		   avl_cmp_t cmp)
+{
+	struct avl_node *tmp;
+	size_t i;
+
+	for (i = n / 2; i > 0; i--)
+		avl_sort_sift(nodes, i - 1, n, cmp);
+
+	for (i = n; i > 1; i--) {
+		tmp = nodes[0];
+		nodes[0] = nodes[i - 1];
+		nodes[i - 1] = tmp;
+
+		avl_sort_sift(nodes, 0, i - 1, cmp);
+	}
+
+	avl_build_sorted(root, nodes, n);
+}
+
+/**
+ * avl_batch_sparse() - Check if batch is small compared to subtree
+ * @n: number of nodes in the batch
+ * @height: height of the subtree
+ *
+ * A subtree of height h has roughly 2^(h - 1) nodes. For batches with less
+ * than 1/16 of them, the split and join per batch node cost more than a single
+ * descent from the subtree root.
+ *
+ * Return: true when single descents should be used for the batch
+ */
+static bool avl_batch_sparse(size_t n, size_t height)
+{
+	const size_t shift = 5;
+
+	if (height <= shift || height - shift >= sizeof(size_t) * 8)
+		return false;
+
+	return n < (size_t)1 << (height - shift);
+}
+
+/**
+ * avl_insert_batch_subtree() - Insert sorted nodes in subtree
+ * @tree: subtree receiving the nodes
+ * @nodes: array with nodes sorted by their keys
+ * @n: number of nodes in @nodes
+ * @cmp: compare function for the nodes
+ *
+ * Return: subtree with the nodes of @tree and @nodes
+ */
+static struct avl_subtree avl_insert_batch_subtree(struct avl_subtree tree,
+						   struct avl_node **nodes,
+						   size_t n, avl_cmp_t cmp)
+{
+	struct avl_subtree left;
+	struct avl_subtree right;
+	struct avl_root sub;
+	size_t mid;
+	size_t i;
+
+	if (!n)
+		return tree;
+
+	/* nothing left to merge - just build the rest of the batch */
+	if (!tree.node) {
+		tree.node = avl_build_subtree(nodes, n, NULL);
+		tree.height = avl_height(tree.node);
+		return tree;
+	}
+
+	if (avl_batch_sparse(n, tree.height)) {
+		avl_set_parent(tree.node, NULL);
+
+		sub.node = tree.node;
+		for (i = 0; i < n; i++)
+			avl_add(nodes[i], &sub, cmp);
+
+		tree.node = sub.node;
+		tree.height = avl_height(tree.node);
+		return tree;
+	}
+
+	mid = n / 2;
+	avl_split_subtree(tree, nodes[mid], cmp, true, &left, &right);
+
+	left = avl_insert_batch_subtree(left, nodes, mid, cmp);
+	right = avl_insert_batch_subtree(right, &nodes[mid + 1], n - mid - 1,
+					 cmp);
+
+	return avl_join_subtree(left, nodes[mid], right);
+}
+
+/**
+ * avl_insert_batch() - Insert sorted nodes in tree
+ * @root: pointer to avl root
+ * @nodes: array with new nodes sorted by their keys
+ * @n: number of nodes in @nodes
+ * @cmp: compare function for the nodes
+ *
+ * The tree is split at the middle node of the batch and both halves of the
+ * batch are inserted recursively in the corresponding part of the tree. Parts
+ * of the tree without remaining nodes are not touched and parts of the batch
+ * without remaining tree nodes are build directly. Each affected path is only
+ * rebalanced by the joins of its own recursion. This requires
+ * O(m log(n/m + 1)) steps for m new nodes. Parts of the batch which are small
+ * compared to their part of the tree are added with single descents (see
+ * avl_add) because split and join are more expensive for them. Nodes with keys
+ * equal to nodes in the tree are inserted after them.
+ */
+void avl_insert_batch(struct avl_root *root, struct avl_node **nodes,
+		      size_t n, avl_cmp_t cmp)
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+
+	tree = avl_insert_batch_subtree(tree, nodes, n, cmp);
+	avl_subtree_to_root(root, tree);
+}
+
+/**
+ * avl_split_node() - Split tree in front of or after node
+ * @node: node at which the tree is split
+ * @node_left: true when @node should be the largest node of @left, false when
+ *  it should be the smallest node of @right
+ * @left: returns subtree with all nodes in front of @node
+ * @right: returns subtree with all nodes after @node
+ *
+ * The tree is split bottom up by joining the subtrees of the parents of @node
+ * with the already split parts. No compare function is required for it.
+ */
+static void avl_split_node(struct avl_node *node, bool node_left,
+			   struct avl_subtree *left, struct avl_subtree *right)
+{
+	struct avl_subtree child_left;
+	struct avl_subtree child_right;
+	struct avl_subtree sibling;
+	struct avl_subtree empty;
+	struct avl_node *parent;
+	size_t height;
+	bool is_right;
+
+	empty.node = NULL;
+	empty.height = 0;
+
+	height = avl_height(node);
+	parent = avl_parent(node);
+	is_right = avl_is_right_child(node);
+
+	child_left = avl_subtree_child(node, height, false);
+	child_right = avl_subtree_child(node, height, true);
+
+	if (node_left) {
+		*left = avl_join_subtree(child_left, node, empty);
+		*right = child_right;
+	} else {
+		*left = child_left;
+		*right = avl_join_subtree(empty, node, child_right);
+	}
+
+	while (parent) {
+		node = parent;
+
+		/* height of node before it gets modified by the join */
+		if (avl_balance(node) & (is_right ? AVL_LEFT : AVL_RIGHT))
+			height += 2;
+		else
+			height += 1;
+
+		sibling = avl_subtree_child(node, height, !is_right);
+		parent = avl_parent(node);
+
+		if (is_right) {
+			is_right = avl_is_right_child(node);
+			*left = avl_join_subtree(sibling, node, *left);
+		} else {
+			is_right = avl_is_right_child(node);
+			*right = avl_join_subtree(*right, node, sibling);
+		}
+	}
+}
+
+/**
+ * avl_erase_range() - Remove consecutive nodes from tree
+ * @root: pointer to avl root
+ * @first: first node to remove
+ * @last: last node to remove, must be @first or a successor of @first
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * The tree is split in front of @first and after @last. The middle part is
+ * handed to @drop and the remaining parts are joined again. The k removed
+ * nodes are therefore not rebalanced one by one and the whole operation
+ * requires O(k + log n) steps.
+ */
+void avl_erase_range(struct avl_root *root, struct avl_node *first,
+		     struct avl_node *last, void (*drop)(struct avl_node *node))
+{
+	struct avl_subtree middle;
+	struct avl_subtree right;
+	struct avl_subtree left;
+
+	avl_split_node(first, false, &left, &right);
+
+	/* last has to find the root of the right part when it climbs up */
+	if (right.node)
+		avl_set_parent(right.node, NULL);
+
+	avl_split_node(last, true, &middle, &right);
+	avl_drop_subtree(middle.node, drop);
+
+	avl_subtree_to_root(root, avl_join2_subtree(left, right));
+}
+
+/**
+ * avl_build_list() - Build balanced subtree from sorted node list
+ * @list: pointer to the first node of a list linked via the left pointers,
+ *  returns the first unused node
+ * @n: number of nodes to use from @list
+ * @parent: parent node of the new subtree
+ *
+ * Return: root node of the subtree
+ */
+static struct avl_node *avl_build_list(struct avl_node **list, size_t n,
+				       struct avl_node *parent)
+{
+	struct avl_node *node;
+	struct avl_node *left;
+	size_t n_left;
+	size_t n_right;
+
+	if (!n)
+		return NULL;
+
+	n_left = n / 2;
+	n_right = n - n_left - 1;
+
+	left = avl_build_list(list, n_left, NULL);
+
+	node = *list;
+	*list = node->left;
+
+	avl_set_parent_balance(node, parent, avl_build_balance(n_left, n_right));
+	node->left = left;
+	if (left)
+		avl_set_parent(left, node);
+	node->right = avl_build_list(list, n_right, node);
+
+	return node;
+}
+
+/**
+ * avl_erase_if() - Remove all nodes matching a predicate from tree
+ * @root: pointer to avl root
+ * @pred: function returning true for nodes which have to be removed
+ * @priv: private data for @pred
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * All nodes are visited in order. The left pointer of the visited nodes is no
+ * longer needed by avl_next and is used to collect the remaining and the
+ * removed nodes in two lists. The removed nodes are handed to @drop after the
+ * traversal. The remaining nodes are then build to a new balanced tree. The
+ * whole operation requires O(n) steps without any rotation.
+ */
+void avl_erase_if(struct avl_root *root,
+		  bool (*pred)(const struct avl_node *node, void *priv),
+		  void *priv, void (*drop)(struct avl_node *node))
+{
+	struct avl_node **removed_tail;
+	struct avl_node **kept_tail;
+	struct avl_node *removed;
+	struct avl_node *kept;
+	struct avl_node *node;
+	struct avl_node *next;
+	size_t n = 0;
+
+	removed_tail = &removed;
+	kept_tail = &kept;
+
+	for (node = avl_first(root); node; node = next) {
+		next = avl_next(node);
+
+		if (pred(node, priv)) {
+			*removed_tail = node;
+			removed_tail = &node->left;
+		} else {
+			*kept_tail = node;
+			kept_tail = &node->left;
+			n++;
+		}
+	}
+	*removed_tail = NULL;
+	*kept_tail = NULL;
+
+	while (removed) {
+		node = removed;
+		removed = node->left;
+
+		if (drop)
+			drop(node);
+	}
+
+	avl_store_node(&root->node, avl_build_list(&kept, n, NULL));
+}
+
+/**
+ * avl_replace_node() - Replace node in tree with new node
+ * @old_node: node in the tree which is replaced
+ * @new_node: node which is not part of any tree
+ * @root: pointer to avl root
+ *
+ * @new_node takes over the position, balance and children of @old_node. No
+ * rebalance is necessary. The key of @new_node must be sorted at the same
+ * position as the key of @old_node.
+ */
+void avl_replace_node(struct avl_node *old_node, struct avl_node *new_node,
+		      struct avl_root *root)
+{
+	struct avl_node *parent = avl_parent(old_node);
+
+	avl_set_parent_balance(new_node, parent, avl_balance(old_node));
+	new_node->left = old_node->left;
+	new_node->right = old_node->right;
+
+	if (new_node->left)
+		avl_set_parent(new_node->left, new_node);
+	if (new_node->right)
+		avl_set_parent(new_node->right, new_node);
+
+	avl_change_child(old_node, new_node, parent, root);
+}
+
+/**
+ * avl_add() - Add new node to tree at position of its key
+ * @node: pointer to the new node
+ * @root: pointer to avl root
+ * @cmp: compare function for the nodes
+ *
+ * The tree is descended from the top to find the new leaf position. Nodes with
+ * keys equal to nodes in the tree are added after them.
+ */
+void avl_add(struct avl_node *node, struct avl_root *root, avl_cmp_t cmp)
+{
+	struct avl_node **cur_nodep = &root->node;
+	struct avl_node *parent = NULL;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+
+		if (cmp(node, parent) < 0)
+			cur_nodep = &parent->left;
+		else
+			cur_nodep = &parent->right;
+	}
+
+	avl_insert(node, parent, cur_nodep, root);
+}
+
+/**
+ * avl_reposition() - Move node to correct position after its key changed
+ * @node: pointer to the node with modified key
+ * @root: pointer to avl root
+ * @cmp: compare function for the nodes
+ *
+ * The node is only erased and added again when it is no longer sorted
+ * correctly between its predecessor and its successor. Small key changes
+ * which keep the order therefore cost only the lookup of both neighbors.
+ *
+ * Return: true when the node was moved, false when it is still at the correct
+ *  position
+ */
+bool avl_reposition(struct avl_node *node, struct avl_root *root,
+		    avl_cmp_t cmp)
+{
+	struct avl_node *prev = avl_prev(node);
+	struct avl_node *next = avl_next(node);
+
+	if ((!prev || cmp(prev, node) <= 0) &&
+	    (!next || cmp(node, next) <= 0))
+		return false;
+
+	avl_erase(node, root);
+	avl_add(node, root, cmp);
+
+	return true;
+}
+
+/**
+ * avl_rebalance_run() - Continue pending rebalancing with limited budget
+ * @root: pointer to deferred rebalanced avl root
+ * @budget: maximum number of nodes to rebalance
+ *
+ * Return: unused part of @budget
+ */
+static size_t avl_rebalance_run(struct avl_root_deferred *root, size_t budget)
+{
+	struct avl_node *node = root->pending;
+	struct avl_node *parent;
+
+	while (node && budget) {
+		budget--;
+
+		if (root->pending_erase) {
+			node = avl_erase_step(node, root->pending_right,
+					      &root->root, NULL);
+			if (!node)
+				break;
+
+			root->pending_right = avl_is_right_child(node);
+			node = avl_parent(node);
+		} else {
+			parent = avl_parent(node);
+			if (!parent ||
+			    !avl_insert_step(node, parent, &root->root,
+					     NULL)) {
+				node = NULL;
+				break;
+			}
+
+			node = parent;
+		}
+	}
+
+	root->pending = node;
+
+	return budget;
+}
+
+/**
+ * avl_rebalance_step() - Continue pending rebalancing of tree
+ * @root: pointer to deferred rebalanced avl root
+ * @budget: maximum number of nodes to rebalance
+ *
+ * Each node on the path upwards (including a rotation at this node) uses one
+ * step of @budget.
+ *
+ * Return: true when rebalancing is still pending, false when the tree is
+ *  balanced again
+ */
+bool avl_rebalance_step(struct avl_root_deferred *root, size_t budget)
+{
+	avl_rebalance_run(root, budget);
+
+	return root->pending != NULL;
+}
+
+/**
+ * avl_add_deferred() - Add new node and partially rebalance
+ * @node: pointer to the new node
+ * @root: pointer to deferred rebalanced avl root
+ * @cmp: compare function for the nodes
+ * @budget: maximum number of nodes to rebalance in this call
+ *
+ * A pending rebalancing of a previous modification is continued first. Only
+ * when it could be finished with @budget, the new leaf position is searched
+ * (see avl_add) and the rest of @budget is used to rebalance after the
+ * insert. The work of a call is therefore limited by @budget and the height
+ * of the tree.
+ *
+ * Return: true when the node was added, false when the tree still has to be
+ *  rebalanced (avl_rebalance_step) before the node can be added
+ */
+bool avl_add_deferred(struct avl_node *node, struct avl_root_deferred *root,
+		      avl_cmp_t cmp, size_t budget)
+{
+	struct avl_node **cur_nodep = &root->root.node;
+	struct avl_node *parent = NULL;
+
+	budget = avl_rebalance_run(root, budget);
+	if (root->pending)
+		return false;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+
+		if (cmp(node, parent) < 0)
+			cur_nodep = &parent->left;
+		else
+			cur_nodep = &parent->right;
+	}
+
+	avl_link_node(node, parent, cur_nodep);
+
+	root->pending = node;
+	root->pending_erase = false;
+	avl_rebalance_run(root, budget);
+
+	return true;
+}
+
+/**
+ * avl_erase_deferred() - Remove avl node from tree and partially rebalance
+ * @node: pointer to the node
+ * @root: pointer to deferred rebalanced avl root
+ * @budget: maximum number of nodes to rebalance in this call
+ *
+ * A pending rebalancing of a previous modification is continued first. Only
+ * when it could be finished with @budget, the node is removed and the rest of
+ * @budget is used to rebalance after the removal.
+ *
+ * Return: true when the node was removed, false when the tree still has to be
+ *  rebalanced (avl_rebalance_step) before the node can be removed
+ */
+bool avl_erase_deferred(struct avl_node *node, struct avl_root_deferred *root,
+			size_t budget)
+{
+	bool removed_right;
+
+	budget = avl_rebalance_run(root, budget);
+	if (root->pending)
+		return false;
+
+	root->pending = avl_erase_node(node, &root->root, &removed_right);
+	root->pending_erase = true;
+	root->pending_right = removed_right;
+	avl_rebalance_run(root, budget);
+
+	return true;
+}
+
+/**
+ * avl_lazy_is_dead() - Check if lazy deletion node is marked as deleted
+ * @node: pointer to the avl node of a lazy deletion node
+ * @priv: unused
+ *
+ * Return: true when the node is dead
+ */
+static bool avl_lazy_is_dead(const struct avl_node *node, void *priv)
+{
+	(void)priv;
+
+	return container_of(node, const struct avl_lazy_node, avl)->dead;
+}
+
+/**
+ * avl_compact() - Remove all nodes marked as deleted
+ * @root: pointer to lazy deletion avl root
+ * @drop: function receiving the removed nodes, can be NULL
+ *
+ * The remaining nodes are rebuild to a balanced tree in O(n) steps (see
+ * avl_erase_if).
+ */
+void avl_compact(struct avl_root_lazy *root,
+		 void (*drop)(struct avl_node *node))
+{
+	if (!root->dead)
+		return;
+
+	avl_erase_if(&root->root, avl_lazy_is_dead, NULL, drop);
+	root->count -= root->dead;
+	root->dead = 0;
+}
+
+/**
+ * avl_lazy_live() - Get first live node starting at node
+ * @node: pointer to the avl node of a lazy deletion node, can be NULL
+ *
+ * Return: @node or its first live successor, NULL if no such node exists
+ */
+static struct avl_lazy_node *avl_lazy_live(struct avl_node *node)
+{
+	struct avl_lazy_node *lazy;
+
+	for (; node; node = avl_next(node)) {
+		lazy = container_of(node, struct avl_lazy_node, avl);
+		if (!lazy->dead)
+			return lazy;
+	}
+
+	return NULL;
+}
+
+/**
+ * avl_lazy_first() - Find leftmost live node in lazy deletion tree
+ * @root: pointer to lazy deletion avl root
+ *
+ * Return: pointer to leftmost live node. NULL when @root has no live node.
+ */
+struct avl_lazy_node *avl_lazy_first(const struct avl_root_lazy *root)
+{
+	return avl_lazy_live(avl_first(&root->root));
+}
+
+/**
+ * avl_lazy_next() - Find successor live node in lazy deletion tree
+ * @node: pointer to the node
+ *
+ * Return: pointer to next live node, NULL when @node is the last live node
+ */
+struct avl_lazy_node *avl_lazy_next(struct avl_lazy_node *node)
+{
+	return avl_lazy_live(avl_next(&node->avl));
+}
+
+/**
+ * avl_lazy_find() - Find live node with key in lazy deletion tree
+ * @root: pointer to lazy deletion avl root
+ * @key: node with the key to search for
+ * @cmp: compare function for the nodes
+ *
+ * Dead nodes may still have the same key as live nodes. The search therefore
+ * starts at the first node with the key and skips the dead ones.
+ *
+ * Return: first live node with key equal to @key, NULL if no such node exists
+ */
+struct avl_lazy_node *avl_lazy_find(const struct avl_root_lazy *root,
+				    const struct avl_node *key, avl_cmp_t cmp)
+{
+	struct avl_node *node = root->root.node;
+	struct avl_node *found = NULL;
+	struct avl_lazy_node *lazy;
+	int res;
+
+	while (node) {
+		res = cmp(key, node);
+		if (res == 0)
+			found = node;
+
+		if (res <= 0)
+			node = node->left;
+		else
+			node = node->right;
+	}
+
+	for (node = found; node && cmp(key, node) == 0; node = avl_next(node)) {
+		lazy = container_of(node, struct avl_lazy_node, avl);
+		if (!lazy->dead)
+			return lazy;
+	}
+
+	return NULL;
+}
+
+/**
+ * struct avl_relayout_ctx - state of avl_relayout
+ * @dest: buffer receiving the copied entries
+ * @entry_size: size of an entry
+ * @member_offset: offset of the avl node in an entry
+ * @moved: function receiving old and new node, can be NULL
+ * @count: number of entries already copied to @dest
+ */
+struct avl_relayout_ctx {
+	char *dest;
+	size_t entry_size;
+	size_t member_offset;
+	void (*moved)(struct avl_node *old_node, struct avl_node *new_node);
+	size_t count;
+};
+
+/**
+ * avl_relayout_place() - Copy entry of node to next free slot
+ * @ctx: state of the relayout
+ * @node: node whose entry is copied
+ *
+ * The left pointer of @node is afterwards used as forward pointer to the new
+ * node. The original left pointer is only available in the copy.
+ */
+static void avl_relayout_place(struct avl_relayout_ctx *ctx,
+			       struct avl_node *node)
+{
+	char *entry = (char *)node - ctx->member_offset;
+	char *new_entry = ctx->dest + ctx->count * ctx->entry_size;
+	struct avl_node *new_node;
+
+	new_node = (struct avl_node *)(new_entry + ctx->member_offset);
+	memcpy(new_entry, entry, ctx->entry_size);
+	ctx->count++;
+
+	node->left = new_node;
+
+	if (ctx->moved)
+		ctx->moved(node, new_node);
+}
+
+static void avl_relayout_veb(struct avl_relayout_ctx *ctx,
+			     struct avl_node *node, size_t levels);
+
+/**
+ * avl_relayout_veb_bottom() - Copy subtrees below top tree in vEB order
+ * @ctx: state of the relayout
+ * @node: already copied node of the top tree
+ * @depth: depth of the subtrees below @node
+ * @levels: number of levels of each subtree to copy
+ */
+static void avl_relayout_veb_bottom(struct avl_relayout_ctx *ctx,
+				    struct avl_node *node, size_t depth,
+				    size_t levels)
+{
+	struct avl_node *copy;
+
+	if (!node)
+		return;
+
+	if (!depth) {
+		avl_relayout_veb(ctx, node, levels);
+		return;
+	}
+
+	/* children of copied nodes are only available in the copy */
+	copy = node->left;
+	avl_relayout_veb_bottom(ctx, copy->left, depth - 1, levels);
+	avl_relayout_veb_bottom(ctx, copy->right, depth - 1, levels);
+}
+
+/**
+ * avl_relayout_veb() - Copy subtree in van Emde Boas order
+ * @ctx: state of the relayout
+ * @node: root node of the subtree
+ * @levels: number of levels of the subtree to copy
+ *
+ * The upper half of the levels is copied first (recursively in the same
+ * order). The subtrees hanging below it follow one after another.
+ */
+static void avl_relayout_veb(struct avl_relayout_ctx *ctx,
+			     struct avl_node *node, size_t levels)
+{
+	size_t top;
+
+	if (!node || !levels)
+		return;
+
+	if (levels == 1) {
+		avl_relayout_place(ctx, node);
+		return;
+	}
+
+	top = levels / 2;
+	avl_relayout_veb(ctx, node, top);
+	avl_relayout_veb_bottom(ctx, node, top, levels - top);
+}
+
+/**
+ * avl_relayout() - Copy all entries of tree to consecutive memory
+ * @root: pointer to avl root
+ * @dest: buffer with space for all entries of the tree
+ * @entry_size: size of an entry (e.g. sizeof(struct item))
+ * @member_offset: offset of the avl node in an entry (e.g.
+ *  offsetof(struct item, avl))
+ * @layout: order of the entries in @dest
+ * @moved: function receiving old and new node of each entry, can be NULL
+ *
+ * The entries are first copied in the selected order. The left pointer of each
+ * old node is then used as forward pointer to its copy. The parent, left and
+ * right pointers of the copies are rewritten afterwards with these forward
+ * pointers. The shape and balance of the tree don't change and no key is
+ * compared.
+ *
+ * @moved is called while the tree is copied. It can be used to update external
+ * references to the entries but must not access the tree. The old entries must
+ * not be accessed by other tree functions after the relayout. Pointers to other
+ * entries inside the entries (e.g. avl_list_node) are not rewritten.
+ *
+ * Return: number of entries copied to @dest
+ */
+size_t avl_relayout(struct avl_root *root, void *dest, size_t entry_size,
+		    size_t member_offset, enum avl_layout layout,
+		    void (*moved)(struct avl_node *old_node,
+				  struct avl_node *new_node))
+{
+	struct avl_relayout_ctx ctx;
+	struct avl_node *parent;
+	struct avl_node *node;
+	struct avl_node *next;
+	size_t i;
+
+	ctx.dest = (char *)dest;
+	ctx.entry_size = entry_size;
+	ctx.member_offset = member_offset;
+	ctx.moved = moved;
+	ctx.count = 0;
+
+	if (!root->node)
+		return 0;
+
+	switch (layout) {
+	case AVL_LAYOUT_VEB:
+		avl_relayout_veb(&ctx, root->node, avl_height(root->node));
+		break;
+	default:
+	case AVL_LAYOUT_INORDER:
+		/* avl_next doesn't need the left pointer of visited nodes */
+		for (node = avl_first(root); node; node = next) {
+			next = avl_next(node);
+			avl_relayout_place(&ctx, node);
+		}
+		break;
+	}
+
+	/* switch all links from old nodes to their copies */
+	for (i = 0; i < ctx.count; i++) {
+		node = (struct avl_node *)(ctx.dest + i * entry_size +
+					   member_offset);
+
+		parent = avl_parent(node);
+		if (parent)
+			avl_set_parent(node, parent->left);
+		if (node->left)
+			node->left = node->left->left;
+		if (node->right)
+			node->right = node->right->left;
+	}
+
+	avl_store_node(&root->node, root->node->left);
+
+	return ctx.count;
+}
+
+/**
+ * avl_finger_find() - Find node with key starting at last found node
+ * @root: pointer to avl root
+ * @finger: pointer to the last accessed node, NULL to start at the root.
+ *  Returns the found node or a node next to the position of @key on a miss
+ * @key: node with the key to search for
+ * @cmp: compare function for the nodes
+ *
+ * A key between the direct neighbors (avl_prev, avl_next) of @finger is found
+ * with at most two compares. Otherwise, the tree is climbed from the neighbor
+ * only until a subtree is reached whose key range contains @key. The key range
+ * of a subtree is limited by the first ancestor which has the subtree in the
+ * opposite direction. The search then descends as usual.
+ *
+ * The climb is only short for local access patterns. Its worst case stays
+ * O(log n) even for close keys, e.g. when the root is between @finger and @key.
+ *
+ * The finger must be reset to NULL when the node it points to is erased from
+ * the tree.
+ *
+ * Return: node with key equal to @key, NULL if no such node exists
+ */
+struct avl_node *avl_finger_find(const struct avl_root *root,
+				 struct avl_node **finger,
+				 const struct avl_node *key, avl_cmp_t cmp)
+{
+	struct avl_node *node = *finger;
+	struct avl_node *neighbor;
+	struct avl_node *parent;
+	struct avl_node *last;
+	int res_neighbor;
+	int res;
+
+	if (!node)
+		node = root->node;
+
+	if (!node)
+		return NULL;
+
+	res = cmp(key, node);
+	if (res == 0) {
+		*finger = node;
+		return node;
+	}
+
+	/* key next to the finger doesn't require a climb */
+	if (*finger) {
+		if (res < 0)
+			neighbor = avl_prev(node);
+		else
+			neighbor = avl_next(node);
+
+		if (!neighbor)
+			return NULL;
+
+		res_neighbor = cmp(key, neighbor);
+		if (res_neighbor == 0) {
+			*finger = neighbor;
+			return neighbor;
+		}
+
+		if ((res_neighbor < 0) != (res < 0))
+			return NULL;
+
+		node = neighbor;
+		res = res_neighbor;
+	}
+
+	/* climb until an ancestor limits the subtree on the side of key */
+	while ((parent = avl_parent(node))) {
+		if ((res > 0) == (parent->left == node)) {
+			res = cmp(key, parent);
+			if (res == 0) {
+				*finger = parent;
+				return parent;
+			}
+
+			if ((res > 0) != (parent->left == node))
+				break;
+		}
+
+		node = parent;
+	}
+
+	/* descend in the subtree which contains the key range */
+	do {
+		last = node;
+
+		res = cmp(key, node);
+		if (res == 0) {
+			*finger = node;
+			return node;
+		}
+
+		if (res < 0)
+			node = node->left;
+		else
+			node = node->right;
+	} while (node);
+
+	*finger = last;
+
+	return NULL;
+}
+
+/**
+ * avl_prefix_cmp() - Compare prefix nodes
+ * @a: first prefix node
+ * @b: second prefix node
+ * @cmp: compare function for equal prefixes
+ *
+ * Return: <0 when @a is smaller than @b, 0 when both are equal and >0 when @a
+ *  is larger than @b
+ */
+static int avl_prefix_cmp(const struct avl_prefix_node *a,
+			  const struct avl_prefix_node *b, avl_cmp_t cmp)
+{
+	if (a->prefix < b->prefix)
+		return -1;
+
+	if (a->prefix > b->prefix)
+		return 1;
+
+	return cmp(&a->avl, &b->avl);
+}
+
+/**
+ * avl_prefix_add() - Add new prefix node to tree at position of its key
+ * @node: pointer to the new node with initialized prefix
+ * @root: pointer to avl root
+ * @cmp: compare function for the avl nodes of two prefix nodes
+ *
+ * Nodes with keys equal to nodes in the tree are added after them.
+ */
+void avl_prefix_add(struct avl_prefix_node *node, struct avl_root *root,
+		    avl_cmp_t cmp)
+{
+	struct avl_node **cur_nodep = &root->node;
+	struct avl_prefix_node *cur;
+	struct avl_node *parent = NULL;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		cur = container_of(parent, struct avl_prefix_node, avl);
+
+		if (avl_prefix_cmp(node, cur, cmp) < 0)
+			cur_nodep = &parent->left;
+		else
+			cur_nodep = &parent->right;
+	}
+
+	avl_insert(&node->avl, parent, cur_nodep, root);
+}
+
+/**
+ * avl_prefix_find() - Find prefix node with key
+ * @root: pointer to avl root
+ * @key: prefix node with the key to search for and its prefix
+ * @cmp: compare function for the avl nodes of two prefix nodes
+ *
+ * @cmp is only called when the prefix of a node is equal to the prefix of
+ * @key.
+ *
+ * Return: node with key equal to @key, NULL if no such node exists
+ */
+struct avl_prefix_node *avl_prefix_find(const struct avl_root *root,
+					const struct avl_prefix_node *key,
+					avl_cmp_t cmp)
+{
+	struct avl_node *node = root->node;
+	struct avl_prefix_node *cur;
+	int res;
+
+	while (node) {
+		cur = container_of(node, struct avl_prefix_node, avl);
+
+		res = avl_prefix_cmp(key, cur, cmp);
+		if (res == 0)
+			return cur;
+
+		if (res < 0)
+			node = node->left;
+		else
+			node = node->right;
+	}
+
+	return NULL;
+}
+
+/**
+ * avl_multi_add() - Add entry to tree or chain of entries with equal key
+ * @node: pointer to the new node
+ * @root: pointer to avl root
+ * @cmp: compare function for the nodes
+ *
+ * A new key is added as head to the tree. An entry with a key which is already
+ * in the tree is appended in O(1) to the chain of the head after the descent.
+ */
+void avl_multi_add(struct avl_multi_node *node, struct avl_root *root,
+		   avl_cmp_t cmp)
+{
+	struct avl_node **cur_nodep = &root->node;
+	struct avl_node *parent = NULL;
+	struct avl_multi_node *head;
+	int res;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+
+		res = cmp(&node->avl, parent);
+		if (res == 0) {
+			head = container_of(parent, struct avl_multi_node, avl);
+
+			node->next = head;
+			node->prev = head->prev;
+			head->prev->next = node;
+			head->prev = node;
+
+			/* mark as chained entry */
+			node->avl.left = &node->avl;
+			return;
+		}
+
+		if (res < 0)
+			cur_nodep = &parent->left;
+		else
+			cur_nodep = &parent->right;
+	}
+
+	node->next = node;
+	node->prev = node;
+	avl_insert(&node->avl, parent, cur_nodep, root);
+}
+
+/**
+ * avl_multi_erase() - Remove entry from tree or chain
+ * @node: pointer to the entry
+ * @root: pointer to avl root
+ *
+ * A chained entry is only unlinked from the chain. A head is replaced in O(1)
+ * by the next entry of its chain. Only the last entry of a key is removed from
+ * the tree and requires a rebalance.
+ */
+void avl_multi_erase(struct avl_multi_node *node, struct avl_root *root)
+{
+	struct avl_multi_node *next = node->next;
+
+	if (node->avl.left == &node->avl) {
+		node->prev->next = next;
+		next->prev = node->prev;
+		return;
+	}
+
+	if (next == node) {
+		avl_erase(&node->avl, root);
+		return;
+	}
+
+	node->prev->next = next;
+	next->prev = node->prev;
+
+	avl_replace_node(&node->avl, &next->avl, root);
+}
+
+/**
+ * avl_multi_find() - Find head of entries with key
+ * @root: pointer to avl root
+ * @key: node with the key to search for
+ * @cmp: compare function for the nodes
+ *
+ * All entries with the key can be visited with avl_multi_next_dup.
+ *
+ * Return: first entry with key equal to @key, NULL if no such entry exists
+ */
+struct avl_multi_node *avl_multi_find(const struct avl_root *root,
+				      const struct avl_node *key,
+				      avl_cmp_t cmp)
+{
+	struct avl_node *node = root->node;
+	int res;
+
+	while (node) {
+		res = cmp(key, node);
+		if (res == 0)
+			return container_of(node, struct avl_multi_node, avl);
+
+		if (res < 0)
+			node = node->left;
+		else
+			node = node->right;
+	}
+
+	return NULL;
+}
+
+/**
+ * avl_augment_propagate() - Recalculate augmented data up to the root
+ * @node: pointer to the lowest node with outdated augmented data
+ * @augment: function to recalculate augmented data of a single node
+ *
+ * Has to be called after the entry data used for the augmented data of @node
+ * changed without modifications of the tree structure.
+ */
+void avl_augment_propagate(struct avl_node *node, avl_augment_t augment)
+{
+	for (; node; node = avl_parent(node))
+		augment(node);
+}
+
+/**
+ * avl_insert_augmented() - Go tree upwards and rebalance augmented tree
+ * @node: pointer to the new node
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data of a single node
+ *
+ * Same as avl_insert_balance but the augmented data of all nodes on the path
+ * to the root and of all rotated nodes is recalculated. @node must be linked
+ * with avl_link_node before.
+ */
+void avl_insert_augmented(struct avl_node *node, struct avl_root *root,
+			  avl_augment_t augment)
+{
+	avl_augment_propagate(node, augment);
+	avl_insert_rebalance(node, root, augment);
+}
+
+/**
+ * avl_erase_augmented() - Remove avl node from augmented tree and rebalance
+ * @node: pointer to the node
+ * @root: pointer to avl root
+ * @augment: function to recalculate augmented data of a single node
+ *
+ * Same as avl_erase but the augmented data of all nodes whose subtree changed
+ * is recalculated. This includes the node which replaced @node and all
+ * rotated nodes.
+ */
+void avl_erase_augmented(struct avl_node *node, struct avl_root *root,
+			 avl_augment_t augment)
+{
+	struct avl_node *decreased_node;
+	bool removed_right;
+
+	/* the path from decreased_node to the root contains all nodes which
+	 * lost a descendant, including the replacement of node
+	 */
+	decreased_node = avl_erase_node(node, root, &removed_right);
+	avl_augment_propagate(decreased_node, augment);
+
+	if (decreased_node)
+		avl_erase_rebalance(decreased_node, removed_right, root,
+				    augment);
+}
+
+/**
+ * avl_aggregate_from() - Aggregate all nodes of subtree not smaller than key
+ * @node: root of the subtree
+ * @lo: pointer to the node with the lower bound key
+ * @cmp: compare function for the nodes
+ * @combine: function to add node or subtree data to @acc
+ * @acc: pointer to the aggregate
+ *
+ * Only nodes on the path to the lower bound are visited. All subtrees right
+ * of this path are added at once.
+ */
+static void avl_aggregate_from(const struct avl_node *node,
+			       const struct avl_node *lo, avl_cmp_t cmp,
+			       avl_combine_t combine, void *acc)
+{
+	if (!node)
+		return;
+
+	if (cmp(node, lo) < 0) {
+		avl_aggregate_from(node->right, lo, cmp, combine, acc);
+		return;
+	}
+
+	avl_aggregate_from(node->left, lo, cmp, combine, acc);
+	combine(acc, node, false);
+	if (node->right)
+		combine(acc, node->right, true);
+}
+
+/**
+ * avl_aggregate_to() - Aggregate all nodes of subtree not larger than key
+ * @node: root of the subtree
+ * @hi: pointer to the node with the upper bound key
+ * @cmp: compare function for the nodes
+ * @combine: function to add node or subtree data to @acc
+ * @acc: pointer to the aggregate
+ *
+ * Only nodes on the path to the upper bound are visited. All subtrees left of
+ * this path are added at once.
+ */
+static void avl_aggregate_to(const struct avl_node *node,
+			     const struct avl_node *hi, avl_cmp_t cmp,
+			     avl_combine_t combine, void *acc)
+{
+	if (!node)
+		return;
+
+	if (cmp(node, hi) > 0) {
+		avl_aggregate_to(node->left, hi, cmp, combine, acc);
+		return;
+	}
+
+	if (node->left)
+		combine(acc, node->left, true);
+	combine(acc, node, false);
+	avl_aggregate_to(node->right, hi, cmp, combine, acc);
+}
+
+/**
+ * avl_range_aggregate() - Aggregate augmented data of all nodes in key range
+ * @root: pointer to avl root
+ * @lo: pointer to the node with the lower bound key (inclusive)
+ * @hi: pointer to the node with the upper bound key (inclusive)
+ * @cmp: compare function for the nodes
+ * @combine: function to add node or subtree data to @acc
+ * @acc: pointer to the aggregate, must be initialized by the caller
+ *
+ * The tree must be augmented (see avl_insert_augmented) with the aggregate of
+ * each subtree. @combine is called in key order for O(log n) single nodes and
+ * complete subtrees. The combine operation must therefore only be associative
+ * and not commutative.
+ */
+void avl_range_aggregate(const struct avl_root *root,
+			 const struct avl_node *lo, const struct avl_node *hi,
+			 avl_cmp_t cmp, avl_combine_t combine, void *acc)
+{
+	const struct avl_node *node = root->node;
+
+	/* find the top most node in the range */
+	while (node) {
+		if (cmp(node, lo) < 0)
+			node = node->right;
+		else if (cmp(node, hi) > 0)
+			node = node->left;
+		else
+			break;
+	}
+
+	if (!node)
+		return;
+
+	avl_aggregate_from(node->left, lo, cmp, combine, acc);
+	combine(acc, node, false);
+	avl_aggregate_to(node->right, hi, cmp, combine, acc);
+}
+
+/**
+ * avl_rope_subtree_size() - Get number of nodes in subtree of sequence
+ * @node: root of the subtree, can be NULL
+ *
+ * Return: number of nodes in the subtree
+ */
+static size_t avl_rope_subtree_size(const struct avl_node *node)
+{
+	if (!node)
+		return 0;
+
+	return container_of(node, const struct avl_rope_node, avl)->size;
+}
+
+/**
+ * avl_rope_augment() - Recalculate size of subtree of sequence node
+ * @node: avl node of the struct avl_rope_node
+ */
+static void avl_rope_augment(struct avl_node *node)
+{
+	struct avl_rope_node *rope = container_of(node, struct avl_rope_node,
+						  avl);
+
+	rope->size = 1 + avl_rope_subtree_size(node->left) +
+		     avl_rope_subtree_size(node->right);
+}
+
+/**
+ * avl_rope_at() - Find node at position in sequence
+ * @root: pointer to avl root of the sequence
+ * @index: position of the node
+ *
+ * Return: node at position @index, NULL when @index is out of range
+ */
+struct avl_rope_node *avl_rope_at(const struct avl_root *root, size_t index)
+{
+	struct avl_node *node = root->node;
+	size_t left_size;
+
+	while (node) {
+		left_size = avl_rope_subtree_size(node->left);
+
+		if (index < left_size) {
+			node = node->left;
+		} else if (index == left_size) {
+			return container_of(node, struct avl_rope_node, avl);
+		} else {
+			index -= left_size + 1;
+			node = node->right;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * avl_rope_index() - Get position of node in sequence
+ * @node: pointer to the node in the sequence
+ *
+ * Return: position of @node
+ */
+size_t avl_rope_index(const struct avl_rope_node *node)
+{
+	const struct avl_node *cur = &node->avl;
+	struct avl_node *parent;
+	size_t index;
+
+	index = avl_rope_subtree_size(cur->left);
+
+	/* all nodes in front of a right child are before node too */
+	while ((parent = avl_parent((struct avl_node *)cur))) {
+		if (parent->right == cur)
+			index += avl_rope_subtree_size(parent->left) + 1;
+
+		cur = parent;
+	}
+
+	return index;
+}
+
+/**
+ * avl_rope_insert_at() - Insert node at position in sequence
+ * @root: pointer to avl root of the sequence
+ * @node: pointer to the new node
+ * @index: new position of @node, at most the number of nodes in the sequence
+ *
+ * The node at @index and all nodes after it move one position back.
+ */
+void avl_rope_insert_at(struct avl_root *root, struct avl_rope_node *node,
+			size_t index)
+{
+	struct avl_node **cur_nodep = &root->node;
+	struct avl_node *parent = NULL;
+	size_t left_size;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		left_size = avl_rope_subtree_size(parent->left);
+
+		if (index <= left_size) {
+			cur_nodep = &parent->left;
+		} else {
+			index -= left_size + 1;
+			cur_nodep = &parent->right;
+		}
+	}
+
+	avl_link_node(&node->avl, parent, cur_nodep);
+	avl_insert_augmented(&node->avl, root, avl_rope_augment);
+}
+
+/**
+ * avl_rope_erase_at() - Remove node at position from sequence
+ * @root: pointer to avl root of the sequence
+ * @index: position of the node
+ *
+ * Return: removed node, NULL when @index is out of range
+ */
+struct avl_rope_node *avl_rope_erase_at(struct avl_root *root, size_t index)
+{
+	struct avl_rope_node *node = avl_rope_at(root, index);
+
+	if (node)
+		avl_erase_augmented(&node->avl, root, avl_rope_augment);
+
+	return node;
+}
+
+/**
+ * avl_rope_split_subtree() - Split subtree of sequence at position
+ * @tree: subtree to split
+ * @index: number of nodes which are moved to @left
+ * @left: returns subtree with the first @index nodes
+ * @right: returns subtree with the remaining nodes
+ */
+static void avl_rope_split_subtree(struct avl_subtree tree, size_t index,
+				   struct avl_subtree *left,
+				   struct avl_subtree *right)
+{
+	struct avl_subtree child_left;
+	struct avl_subtree child_right;
+	struct avl_subtree part;
+	size_t left_size;
+
+	if (!tree.node) {
+		*left = tree;
+		*right = tree;
+		return;
+	}
+
+	child_left = avl_subtree_child(tree.node, tree.height, false);
+	child_right = avl_subtree_child(tree.node, tree.height, true);
+	left_size = avl_rope_subtree_size(child_left.node);
+
+	if (index <= left_size) {
+		avl_rope_split_subtree(child_left, index, left, &part);
+		*right = avl_join_augmented_subtree(part, tree.node,
+						    child_right,
+						    avl_rope_augment);
+	} else {
+		avl_rope_split_subtree(child_right, index - left_size - 1,
+				       &part, right);
+		*left = avl_join_augmented_subtree(child_left, tree.node,
+						   part, avl_rope_augment);
+	}
+}
+
+/**
+ * avl_rope_split_at() - Split sequence at position
+ * @root: pointer to avl root of the sequence
+ * @index: number of nodes which are moved to @left
+ * @left: pointer to avl root which receives the first @index nodes
+ * @right: pointer to avl root which receives the remaining nodes
+ *
+ * The nodes of @root are moved to @left and @right in O(log n). @root is empty
+ * afterwards. @root can be the same as @left or @right.
+ */
+void avl_rope_split_at(struct avl_root *root, size_t index,
+		       struct avl_root *left, struct avl_root *right)
+{
+	struct avl_subtree tree = avl_subtree_root(root);
+	struct avl_subtree tree_left;
+	struct avl_subtree tree_right;
+
+	avl_rope_split_subtree(tree, index, &tree_left, &tree_right);
+
+	INIT_AVL_ROOT(root);
+	avl_subtree_to_root(left, tree_left);
+	avl_subtree_to_root(right, tree_right);
+}
+
+/**
+ * avl_rope_concat() - Append sequence to another sequence
+ * @root: pointer to avl root which receives the concatenated sequence
+ * @left: pointer to avl root of the first part of the sequence
+ * @right: pointer to avl root of the second part of the sequence
+ *
+ * The nodes of @left and @right are moved to @root in O(log n). @left and
+ * @right are empty afterwards. @root can be the same as @left or @right.
+ */
+void avl_rope_concat(struct avl_root *root, struct avl_root *left,
+		     struct avl_root *right)
+{
+	struct avl_subtree tree_right = avl_subtree_root(right);
+	struct avl_subtree tree_left;
+	struct avl_subtree joined;
+	struct avl_rope_node *last;
+
+	if (!left->node) {
+		INIT_AVL_ROOT(right);
+		avl_subtree_to_root(root, tree_right);
+		return;
+	}
+
+	/* last node of left is the middle node for the join */
+	last = avl_rope_erase_at(left, avl_rope_size(left) - 1);
+	tree_left = avl_subtree_root(left);
+
+	joined = avl_join_augmented_subtree(tree_left, &last->avl, tree_right,
+					    avl_rope_augment);
+
+	INIT_AVL_ROOT(left);
+	INIT_AVL_ROOT(right);
+	avl_subtree_to_root(root, joined);
+}
+
+/**
+ * avl_epoch_register() - Add reader to epoch reclamation
+ * @epoch: pointer to epoch reclamation object
+ * @reader: reader to add
+ */
+void avl_epoch_register(struct avl_epoch *epoch,
+			struct avl_epoch_reader *reader)
+{
+	reader->state = 0;
+	reader->next = epoch->readers;
+	epoch->readers = reader;
+}
+
+/**
+ * avl_epoch_unregister() - Remove reader from epoch reclamation
+ * @epoch: pointer to epoch reclamation object
+ * @reader: reader to remove, must not be in a read section
+ */
+void avl_epoch_unregister(struct avl_epoch *epoch,
+			  struct avl_epoch_reader *reader)
+{
+	struct avl_epoch_reader **pos = &epoch->readers;
+
+	while (*pos) {
+		if (*pos == reader) {
+			*pos = reader->next;
+			break;
+		}
+
+		pos = &(*pos)->next;
+	}
+}
+
+/**
+ * avl_epoch_retire() - Defer free of an erased entry
+ * @epoch: pointer to epoch reclamation object
+ * @entry: epoch entry of the erased tree entry
+ * @free_cb: function which frees the tree entry
+ *
+ * The tree entry must already be erased from all trees in which readers can
+ * find it. @free_cb is called by a later avl_epoch_reclaim.
+ */
+void avl_epoch_retire(struct avl_epoch *epoch, struct avl_epoch_entry *entry,
+		      void (*free_cb)(struct avl_epoch_entry *entry))
+{
+	entry->epoch = epoch->epoch;
+	entry->free_cb = free_cb;
+	entry->next = epoch->retired;
+	epoch->retired = entry;
+}
+
+/**
+ * avl_epoch_reclaim() - Free retired entries which are no longer accessed
+ * @epoch: pointer to epoch reclamation object
+ *
+ * The global epoch is advanced when all active readers already observed it.
+ * Entries retired at least two epochs ago cannot be accessed by any reader
+ * anymore and are free'd. Calls which cannot advance the epoch cannot free
+ * anything new and return after checking the readers.
+ *
+ * Return: number of free'd entries
+ */
+size_t avl_epoch_reclaim(struct avl_epoch *epoch)
+{
+	const unsigned long state_mask = ~0UL >> 1;
+	struct avl_epoch_entry **pos;
+	struct avl_epoch_reader *reader;
+	struct avl_epoch_entry *entry;
+	struct avl_epoch_entry *next;
+	unsigned long current;
+	unsigned long state;
+	size_t freed = 0;
+
+	current = epoch->epoch;
+
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+
+	/* readers which didn't see the current epoch block the advance */
+	for (reader = epoch->readers; reader; reader = reader->next) {
+#ifdef AVLTREE_ATOMIC_USE
+		state = __atomic_load_n(&reader->state, __ATOMIC_ACQUIRE);
+#else
+		state = *(volatile unsigned long *)&reader->state;
+#endif
+
+		if ((state & 1) && (state >> 1) != (current & state_mask))
+			break;
+	}
+
+	/* older entries were already free'd when the epoch was advanced */
+	if (reader)
+		return 0;
+
+	current++;
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_store_n(&epoch->epoch, current, __ATOMIC_RELAXED);
+#else
+	*(volatile unsigned long *)&epoch->epoch = current;
+#endif
+
+	/* retired list is sorted by epoch, newest entries first */
+	pos = &epoch->retired;
+	while (*pos && current - (*pos)->epoch < 2)
+		pos = &(*pos)->next;
+
+	entry = *pos;
+	*pos = NULL;
+
+	while (entry) {
+		next = entry->next;
+		entry->free_cb(entry);
+		freed++;
+
+		entry = next;
+	}
+
+	return freed;
+}
@@ -20,6 +20,7 @@ extern "C" {
 
 #if defined(__GNUC__)
 #define AVLTREE_TYPEOF_USE 1
+#define AVLTREE_ATOMIC_USE 1
 #define AVL_NODE_ALIGNED __attribute__ ((aligned(sizeof(uintptr_t))))
 #endif
 
@@ -28,6 +29,15 @@ extern "C" {
 #define AVL_NODE_ALIGNED __declspec(align(sizeof(uintptr_t)))
 #endif
 
+/* lockless readers (avl_root_seq, avl_epoch) require ordered stores of the
+ * node links. AVLTREE_LOCKLESS_READERS must then be defined for all users of
+ * the tree, including avltree.c. Trees without such readers use plain loads
+ * and stores
+ */
+#if defined(AVLTREE_LOCKLESS_READERS) && defined(AVLTREE_ATOMIC_USE)
+#define AVLTREE_ATOMIC_LINKS 1
+#endif
+
 /**
  * container_of() - Calculate address of object that contains address ptr
  * @ptr: pointer to member variable
@@ -52,11 +62,21 @@ extern "C" {
  * @AVL_NEUTRAL: depth of left and right subtree are the same
  * @AVL_LEFT: depth of left subtree is one higher than right subtree
  * @AVL_RIGHT: depth of right subtree is one higher than left subtree
+ * @AVL_WEAK: rank of both subtrees is two lower than the rank of the node,
+ *  only used when AVLTREE_WAVL is defined
+ *
+ * The tree is a weak AVL (rank-balanced) tree when AVLTREE_WAVL is defined.
+ * The depth of a subtree is then replaced by its rank. AVL_LEFT marks that the
+ * rank of the right subtree is two lower than the rank of the node and
+ * AVL_RIGHT the same for the left subtree. AVL_WEAK is the combination of both
+ * and only exists after erase operations. A tree without erase operations is
+ * therefore exactly the same as in the AVL mode.
  */
 enum avl_node_balance {
 	AVL_NEUTRAL = 0,
 	AVL_LEFT = 1,
-	AVL_RIGHT = 2
+	AVL_RIGHT = 2,
+	AVL_WEAK = 3
 };
 
 /**
@@ -90,6 +110,44 @@ struct avl_node {
 	struct avl_node *right;
 } AVL_NODE_ALIGNED;
 
+/**
+ * avl_store_node() - Store node pointer visible for concurrent readers
+ * @link: pointer to the left/right pointer of a node or to node of avl_root
+ * @node: pointer to the stored node
+ *
+ * When AVLTREE_LOCKLESS_READERS is defined, all previous stores (e.g. the
+ * initialization of @node) are guaranteed to be visible before a concurrent
+ * reader can observe @node via @link.
+ */
+static __inline__ void avl_store_node(struct avl_node **link,
+				      struct avl_node *node)
+{
+#if defined(AVLTREE_ATOMIC_LINKS)
+	__atomic_store_n(link, node, __ATOMIC_RELEASE);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	*(struct avl_node *volatile *)link = node;
+#else
+	*link = node;
+#endif
+}
+
+/**
+ * avl_load_node() - Load node pointer stored by avl_store_node
+ * @link: pointer to the left/right pointer of a node or to node of avl_root
+ *
+ * Return: node pointer which can be dereferenced by concurrent readers
+ */
+static __inline__ struct avl_node *avl_load_node(struct avl_node *const *link)
+{
+#if defined(AVLTREE_ATOMIC_LINKS)
+	return __atomic_load_n(link, __ATOMIC_CONSUME);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	return *(struct avl_node *const volatile *)link;
+#else
+	return *link;
+#endif
+}
+
 /**
  * struct avl_root - root of an avl-tree
  * @node: pointer to the root node in the tree
@@ -127,6 +185,119 @@ static __inline__ int avl_empty(const struct avl_root *root)
 	return !root->node;
 }
 
+/**
+ * struct avl_root_seq - root of an avl-tree with sequence count for readers
+ * @root: the avl root protected by @seq
+ * @seq: sequence count, odd while a writer modifies @root
+ *
+ * Writers must be serialized by the caller and have to surround each
+ * modification of @root with avl_seq_write_begin and avl_seq_write_end.
+ *
+ * Readers never block. They sample the sequence count with avl_seq_read_begin,
+ * run the lookup speculatively and have to repeat it when avl_seq_read_retry
+ * reports a concurrent modification. All child pointers (and the node of
+ * @root) must be loaded via avl_load_node during the lookup. A result must not
+ * be used before avl_seq_read_retry confirmed it.
+ *
+ * AVLTREE_LOCKLESS_READERS has to be defined (see avl_store_node). The
+ * rotations and avl_erase_node then publish nodes in an order which doesn't
+ * create a cycle of child pointers. Other modifications (e.g. join, split,
+ * bulk build or avl_relayout) and erased nodes which are reused while readers
+ * are active give no such guarantee. Readers should therefore bound the
+ * number of steps of a lookup and retry when the bound is exceeded.
+ *
+ * WARNING erased nodes may still be accessed by a concurrent reader and must
+ * not be free'd or reused before all readers finished. avl_epoch can be used
+ * to defer the free.
+ */
+struct avl_root_seq {
+	struct avl_root root;
+	unsigned int seq;
+};
+
+/**
+ * DEFINE_AVLROOT_SEQ - define sequence counted tree root and initialize it
+ * @root: name of the new object
+ */
+#define DEFINE_AVLROOT_SEQ(root) \
+	struct avl_root_seq root = { { NULL }, 0 }
+
+/**
+ * INIT_AVL_ROOT_SEQ() - Initialize empty sequence counted tree
+ * @root: pointer to sequence counted avl root
+ */
+static __inline__ void INIT_AVL_ROOT_SEQ(struct avl_root_seq *root)
+{
+	INIT_AVL_ROOT(&root->root);
+	root->seq = 0;
+}
+
+/**
+ * avl_seq_write_begin() - Start modification of sequence counted tree
+ * @root: pointer to sequence counted avl root
+ */
+static __inline__ void avl_seq_write_begin(struct avl_root_seq *root)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_store_n(&root->seq, root->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+	*(volatile unsigned int *)&root->seq = root->seq + 1;
+#endif
+}
+
+/**
+ * avl_seq_write_end() - Finish modification of sequence counted tree
+ * @root: pointer to sequence counted avl root
+ */
+static __inline__ void avl_seq_write_end(struct avl_root_seq *root)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_store_n(&root->seq, root->seq + 1, __ATOMIC_RELEASE);
+#else
+	*(volatile unsigned int *)&root->seq = root->seq + 1;
+#endif
+}
+
+/**
+ * avl_seq_read_begin() - Start speculative lookup in sequence counted tree
+ * @root: pointer to sequence counted avl root
+ *
+ * Return: sequence count which has to be checked with avl_seq_read_retry
+ */
+static __inline__ unsigned int
+avl_seq_read_begin(const struct avl_root_seq *root)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	return __atomic_load_n(&root->seq, __ATOMIC_ACQUIRE);
+#else
+	return *(const volatile unsigned int *)&root->seq;
+#endif
+}
+
+/**
+ * avl_seq_read_retry() - Check if speculative lookup has to be repeated
+ * @root: pointer to sequence counted avl root
+ * @start: sequence count returned by avl_seq_read_begin
+ *
+ * Return: true when a writer modified the tree since avl_seq_read_begin,
+ *  false when the results of the lookup are valid
+ */
+static __inline__ bool avl_seq_read_retry(const struct avl_root_seq *root,
+					  unsigned int start)
+{
+	unsigned int seq;
+
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	seq = __atomic_load_n(&root->seq, __ATOMIC_RELAXED);
+#else
+	seq = *(const volatile unsigned int *)&root->seq;
+#endif
+
+	return (start & 1) || seq != start;
+}
+
 /**
  * avl_parent() - Get parent of node
  * @node: pointer to the avl node
@@ -168,8 +339,14 @@ static __inline__ void avl_set_parent_balance(struct avl_node *node,
 					      enum avl_node_balance balance)
 {
 #ifndef AVL_PARENT_BALANCE_COMBINATION
-	node->parent = parent;
+	avl_store_node(&node->parent, parent);
 	node->balance = balance;
+#elif defined(AVLTREE_ATOMIC_LINKS)
+	__atomic_store_n(&node->parent_balance, (uintptr_t)parent | balance,
+			 __ATOMIC_RELEASE);
+#elif defined(AVLTREE_LOCKLESS_READERS)
+	*(volatile uintptr_t *)&node->parent_balance = (uintptr_t)parent |
+						       balance;
 #else
 	node->parent_balance = (uintptr_t)parent | balance;
 #endif
@@ -195,10 +372,10 @@ static __inline__ void avl_link_node(struct avl_node *node,
 				     struct avl_node **avl_link)
 {
 	avl_set_parent_balance(node, parent, AVL_NEUTRAL);
-	node->left = NULL;
-	node->right = NULL;
+	avl_store_node(&node->left, NULL);
+	avl_store_node(&node->right, NULL);
 
-	*avl_link = node;
+	avl_store_node(avl_link, node);
 }
 
 void avl_insert_balance(struct avl_node *node, struct avl_root *root);
@@ -244,6 +421,649 @@ struct avl_node *avl_last(const struct avl_root *root);
 struct avl_node *avl_next(struct avl_node *node);
 struct avl_node *avl_prev(struct avl_node *node);
 
+/**
+ * typedef avl_cmp_t - Compare function for the keys of two avl nodes
+ * @a: pointer to the first avl node
+ * @b: pointer to the second avl node
+ *
+ * Return: <0 when @a is smaller than @b, 0 when both are equal and >0 when @a
+ *  is larger than @b
+ */
+typedef int (*avl_cmp_t)(const struct avl_node *a, const struct avl_node *b);
+
+/**
+ * typedef avl_augment_t - Recalculate augmented data of an avl node
+ * @node: pointer to the avl node
+ *
+ * The augmented data of @node must only be calculated from the entry of @node
+ * and the (already correct) augmented data of its children.
+ */
+typedef void (*avl_augment_t)(struct avl_node *node);
+
+void avl_augment_propagate(struct avl_node *node, avl_augment_t augment);
+void avl_insert_augmented(struct avl_node *node, struct avl_root *root,
+			  avl_augment_t augment);
+void avl_erase_augmented(struct avl_node *node, struct avl_root *root,
+			 avl_augment_t augment);
+
+/**
+ * typedef avl_combine_t - Add data of node or subtree to aggregate
+ * @acc: pointer to the aggregate
+ * @node: pointer to the avl node
+ * @subtree: true when the augmented data of the whole subtree of @node has to
+ *  be added, false when only the data of @node has to be added
+ */
+typedef void (*avl_combine_t)(void *acc, const struct avl_node *node,
+			      bool subtree);
+
+void avl_range_aggregate(const struct avl_root *root,
+			 const struct avl_node *lo, const struct avl_node *hi,
+			 avl_cmp_t cmp, avl_combine_t combine, void *acc);
+
+void avl_join(struct avl_root *root, struct avl_root *left,
+	      struct avl_node *node, struct avl_root *right);
+struct avl_node *avl_split(struct avl_root *root, const struct avl_node *key,
+			   avl_cmp_t cmp, struct avl_root *left,
+			   struct avl_root *right);
+void avl_union(struct avl_root *root, struct avl_root *other, avl_cmp_t cmp,
+	       void (*drop)(struct avl_node *node));
+void avl_intersect(struct avl_root *root, const struct avl_root *other,
+		   avl_cmp_t cmp, void (*drop)(struct avl_node *node));
+void avl_difference(struct avl_root *root, const struct avl_root *other,
+		    avl_cmp_t cmp, void (*drop)(struct avl_node *node));
+
+/**
+ * struct avl_range - in-order range of avl nodes
+ * @first: first node of the range
+ * @lead: node in front of @subtree which belongs to the range (internal)
+ * @subtree: subtree which belongs to the range (internal)
+ * @height: height of @subtree (internal)
+ *
+ * The range ends in front of @first of the next range in the array. The last
+ * range ends at the end of the tree.
+ */
+struct avl_range {
+	struct avl_node *first;
+	struct avl_node *lead;
+	struct avl_node *subtree;
+	size_t height;
+};
+
+size_t avl_partition(const struct avl_root *root, struct avl_range *parts,
+		     size_t nparts);
+void avl_build_sorted(struct avl_root *root, struct avl_node **nodes,
+		      size_t n);
+void avl_bulk_load(struct avl_root *root, struct avl_node **nodes, size_t n,
+		   avl_cmp_t cmp);
+void avl_insert_batch(struct avl_root *root, struct avl_node **nodes,
+		      size_t n, avl_cmp_t cmp);
+void avl_erase_range(struct avl_root *root, struct avl_node *first,
+		     struct avl_node *last, void (*drop)(struct avl_node *node));
+void avl_erase_if(struct avl_root *root,
+		  bool (*pred)(const struct avl_node *node, void *priv),
+		  void *priv, void (*drop)(struct avl_node *node));
+void avl_replace_node(struct avl_node *old_node, struct avl_node *new_node,
+		      struct avl_root *root);
+void avl_add(struct avl_node *node, struct avl_root *root, avl_cmp_t cmp);
+bool avl_reposition(struct avl_node *node, struct avl_root *root,
+		    avl_cmp_t cmp);
+
+/**
+ * avl_range_end() - Get first node after range
+ * @parts: array with ranges returned by avl_partition
+ * @count: number of ranges in @parts
+ * @i: index of the range
+ *
+ * Return: first node after the range @i, NULL when @i is the last range
+ */
+static __inline__ struct avl_node *avl_range_end(const struct avl_range *parts,
+						 size_t count, size_t i)
+{
+	if (i + 1 >= count)
+		return NULL;
+
+	return parts[i + 1].first;
+}
+
+/**
+ * struct avl_root_deferred - root of avl tree with deferred rebalancing
+ * @root: avl root of the tree
+ * @pending: node at which the rebalancing has to be continued, NULL when the
+ *  tree is balanced
+ * @pending_erase: @pending has to be fixed after an erase instead of an insert
+ * @pending_right: right child of @pending decreased its height (erase only)
+ *
+ * The rebalancing after a modification is stopped after a given budget of
+ * steps (nodes on the path upwards). Only one such fixup can be pending. The
+ * next modification continues it with its own budget and is refused when the
+ * fixup could not be finished with it. The rest can also be done via
+ * avl_rebalance_step, e.g. when the event loop is idle.
+ *
+ * The tree can be searched at any time. It is always a balanced tree with at
+ * most one modification which is not yet rebalanced. Its height is therefore
+ * at most one level higher than the height of a balanced tree with the same
+ * nodes (below 1.44 * log2(n + 2) + 1 for n nodes without AVLTREE_WAVL).
+ *
+ * The tree must only be modified via avl_add_deferred and avl_erase_deferred.
+ */
+struct avl_root_deferred {
+	struct avl_root root;
+	struct avl_node *pending;
+	bool pending_erase;
+	bool pending_right;
+};
+
+/**
+ * DEFINE_AVLROOT_DEFERRED - define deferred rebalanced tree root and
+ *  initialize it
+ * @root: name of the new object
+ */
+#define DEFINE_AVLROOT_DEFERRED(root) \
+	struct avl_root_deferred root = { { NULL }, NULL, false, false }
+
+/**
+ * INIT_AVL_ROOT_DEFERRED() - Initialize empty deferred rebalanced tree
+ * @root: pointer to deferred rebalanced avl root
+ */
+static __inline__ void INIT_AVL_ROOT_DEFERRED(struct avl_root_deferred *root)
+{
+	INIT_AVL_ROOT(&root->root);
+	root->pending = NULL;
+	root->pending_erase = false;
+	root->pending_right = false;
+}
+
+bool avl_rebalance_step(struct avl_root_deferred *root, size_t budget);
+bool avl_add_deferred(struct avl_node *node, struct avl_root_deferred *root,
+		      avl_cmp_t cmp, size_t budget);
+bool avl_erase_deferred(struct avl_node *node, struct avl_root_deferred *root,
+			size_t budget);
+
+/**
+ * avl_rebalance_finish() - Finish pending rebalancing of tree
+ * @root: pointer to deferred rebalanced avl root
+ */
+static __inline__ void avl_rebalance_finish(struct avl_root_deferred *root)
+{
+	avl_rebalance_step(root, ~(size_t)0);
+}
+
+/**
+ * struct avl_lazy_node - avl node which can be marked as deleted
+ * @avl: avl node which is linked in the tree
+ * @dead: node was marked as deleted but is still linked in the tree
+ */
+struct avl_lazy_node {
+	struct avl_node avl;
+	bool dead;
+};
+
+/**
+ * struct avl_root_lazy - root of avl tree with lazy deletion
+ * @root: avl root of the tree
+ * @count: number of nodes linked in the tree (including dead nodes)
+ * @dead: number of nodes marked as deleted
+ *
+ * Nodes are only marked as deleted by avl_mark_deleted. They stay in the tree
+ * until avl_compact removes all of them in a single linear rebuild. The
+ * avl_lazy_* iteration and lookup helpers skip the dead nodes.
+ */
+struct avl_root_lazy {
+	struct avl_root root;
+	size_t count;
+	size_t dead;
+};
+
+/**
+ * DEFINE_AVLROOT_LAZY - define lazy deletion tree root and initialize it
+ * @root: name of the new object
+ */
+#define DEFINE_AVLROOT_LAZY(root) \
+	struct avl_root_lazy root = { { NULL }, 0, 0 }
+
+/**
+ * INIT_AVL_ROOT_LAZY() - Initialize empty lazy deletion tree
+ * @root: pointer to lazy deletion avl root
+ */
+static __inline__ void INIT_AVL_ROOT_LAZY(struct avl_root_lazy *root)
+{
+	INIT_AVL_ROOT(&root->root);
+	root->count = 0;
+	root->dead = 0;
+}
+
+/**
+ * avl_lazy_insert() - Add new live node as new leaf and rebalance tree
+ * @node: pointer to the new node
+ * @parent: pointer to the parent node
+ * @avl_link: pointer to the left/right pointer of @parent
+ * @root: pointer to lazy deletion avl root
+ */
+static __inline__ void avl_lazy_insert(struct avl_lazy_node *node,
+				       struct avl_node *parent,
+				       struct avl_node **avl_link,
+				       struct avl_root_lazy *root)
+{
+	node->dead = false;
+	avl_insert(&node->avl, parent, avl_link, &root->root);
+	root->count++;
+}
+
+/**
+ * avl_mark_deleted() - Mark node as deleted in O(1)
+ * @node: pointer to the node
+ * @root: pointer to lazy deletion avl root
+ *
+ * The node is not unlinked from the tree and must not be free'd before it was
+ * removed by avl_compact. Marking an already deleted node again is ignored.
+ */
+static __inline__ void avl_mark_deleted(struct avl_lazy_node *node,
+					struct avl_root_lazy *root)
+{
+	if (node->dead)
+		return;
+
+	node->dead = true;
+	root->dead++;
+}
+
+/**
+ * avl_compact_due() - Check if dead nodes exceed threshold
+ * @root: pointer to lazy deletion avl root
+ * @percent: maximum percentage of dead nodes in the tree
+ *
+ * Return: true when more than @percent percent of the nodes are dead
+ */
+static __inline__ bool avl_compact_due(const struct avl_root_lazy *root,
+				       unsigned int percent)
+{
+	return root->dead * 100 > root->count * percent;
+}
+
+void avl_compact(struct avl_root_lazy *root,
+		 void (*drop)(struct avl_node *node));
+struct avl_lazy_node *avl_lazy_first(const struct avl_root_lazy *root);
+struct avl_lazy_node *avl_lazy_next(struct avl_lazy_node *node);
+struct avl_lazy_node *avl_lazy_find(const struct avl_root_lazy *root,
+				    const struct avl_node *key, avl_cmp_t cmp);
+
+/**
+ * enum avl_layout - memory order of entries created by avl_relayout
+ * @AVL_LAYOUT_INORDER: entries are stored in key order
+ * @AVL_LAYOUT_VEB: entries are stored in van Emde Boas order
+ *
+ * The in-order layout makes range scans via avl_next sequential. The van Emde
+ * Boas layout stores small subtrees in consecutive memory and thus keeps the
+ * number of cache lines touched by a lookup low.
+ */
+enum avl_layout {
+	AVL_LAYOUT_INORDER = 0,
+	AVL_LAYOUT_VEB = 1
+};
+
+size_t avl_relayout(struct avl_root *root, void *dest, size_t entry_size,
+		    size_t member_offset, enum avl_layout layout,
+		    void (*moved)(struct avl_node *old_node,
+				  struct avl_node *new_node));
+struct avl_node *avl_finger_find(const struct avl_root *root,
+				 struct avl_node **finger,
+				 const struct avl_node *key, avl_cmp_t cmp);
+
+/**
+ * struct avl_prefix_node - avl node with inline key prefix
+ * @avl: avl node which is linked in the tree
+ * @prefix: order preserving prefix of the key of the entry
+ *
+ * @prefix is stored directly after the child pointers. A descent can
+ * therefore compare most levels without loading the key from the entry. Two
+ * prefixes must compare like their keys (e.g. the first 8 bytes of a string
+ * in big endian order) and equal prefixes are resolved with the full compare
+ * function.
+ */
+struct avl_prefix_node {
+	struct avl_node avl;
+	uint64_t prefix;
+};
+
+/**
+ * avl_prefix_from_bytes() - Calculate order preserving prefix of byte key
+ * @data: pointer to the key
+ * @len: length of the key
+ *
+ * The first 8 bytes are stored in big endian order. Shorter keys are padded
+ * with zeros.
+ *
+ * Return: prefix for struct avl_prefix_node
+ */
+static __inline__ uint64_t avl_prefix_from_bytes(const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	uint64_t prefix = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(prefix); i++) {
+		prefix <<= 8;
+		if (i < len)
+			prefix |= bytes[i];
+	}
+
+	return prefix;
+}
+
+void avl_prefix_add(struct avl_prefix_node *node, struct avl_root *root,
+		    avl_cmp_t cmp);
+struct avl_prefix_node *avl_prefix_find(const struct avl_root *root,
+					const struct avl_prefix_node *key,
+					avl_cmp_t cmp);
+
+/**
+ * struct avl_multi_node - avl node with chain of entries with equal keys
+ * @avl: avl node, only linked in the tree for the first entry of a key
+ * @prev: previous entry in the circular chain of entries with equal keys
+ * @next: next entry in the circular chain of entries with equal keys
+ *
+ * Only the first entry (head) of each key is linked in the tree. All other
+ * entries with the same key are chained behind it in insertion order. The
+ * height of the tree therefore only depends on the number of distinct keys.
+ * The left pointer of @avl of a chained entry points to @avl itself.
+ */
+struct avl_multi_node {
+	struct avl_node avl;
+	struct avl_multi_node *prev;
+	struct avl_multi_node *next;
+};
+
+/**
+ * avl_multi_next_dup() - Get next entry with the same key
+ * @head: pointer to the head of the chain (e.g. returned by avl_multi_find)
+ * @node: pointer to an entry in the chain of @head
+ *
+ * Return: next entry with equal key, NULL when @node is the last one
+ */
+static __inline__ struct avl_multi_node *
+avl_multi_next_dup(const struct avl_multi_node *head,
+		   const struct avl_multi_node *node)
+{
+	if (node->next == head)
+		return NULL;
+
+	return node->next;
+}
+
+void avl_multi_add(struct avl_multi_node *node, struct avl_root *root,
+		   avl_cmp_t cmp);
+void avl_multi_erase(struct avl_multi_node *node, struct avl_root *root);
+struct avl_multi_node *avl_multi_find(const struct avl_root *root,
+				      const struct avl_node *key,
+				      avl_cmp_t cmp);
+
+/**
+ * struct avl_rope_node - avl node of a sequence ordered by position
+ * @avl: avl node which is linked in the tree
+ * @size: number of nodes in the subtree of @avl
+ *
+ * The position in the sequence is the implicit key of the node. It is never
+ * stored but calculated from @size of the left subtrees on the path to the
+ * root. All modifications of the sequence must use the avl_rope_* functions
+ * to keep @size correct.
+ */
+struct avl_rope_node {
+	struct avl_node avl;
+	size_t size;
+};
+
+/**
+ * avl_rope_size() - Get number of nodes in sequence
+ * @root: pointer to avl root of the sequence
+ *
+ * Return: number of nodes in the sequence
+ */
+static __inline__ size_t avl_rope_size(const struct avl_root *root)
+{
+	if (!root->node)
+		return 0;
+
+	return container_of(root->node, struct avl_rope_node, avl)->size;
+}
+
+struct avl_rope_node *avl_rope_at(const struct avl_root *root, size_t index);
+size_t avl_rope_index(const struct avl_rope_node *node);
+void avl_rope_insert_at(struct avl_root *root, struct avl_rope_node *node,
+			size_t index);
+struct avl_rope_node *avl_rope_erase_at(struct avl_root *root, size_t index);
+void avl_rope_split_at(struct avl_root *root, size_t index,
+		       struct avl_root *left, struct avl_root *right);
+void avl_rope_concat(struct avl_root *root, struct avl_root *left,
+		     struct avl_root *right);
+
+/**
+ * struct avl_list_node - avl node which is also linked in an in-order list
+ * @avl: avl node which is linked in the tree
+ * @prev: in-order predecessor, NULL for the first node
+ * @next: in-order successor, NULL for the last node
+ *
+ * The companion list is maintained by avl_list_insert and avl_list_erase.
+ * Rotations never change the in-order sequence and therefore don't have to
+ * touch it. avl_list_next and avl_list_prev are O(1) in the worst case.
+ *
+ * This is not a threaded tree. The node is two pointers larger than an
+ * avl_node, avl_next and avl_prev keep their O(log n) worst case and the tree
+ * must only be modified via the avl_list_* functions.
+ */
+struct avl_list_node {
+	struct avl_node avl;
+	struct avl_list_node *prev;
+	struct avl_list_node *next;
+};
+
+/**
+ * avl_list_link_node() - Add new listed node as new leaf
+ * @node: pointer to the new node
+ * @parent: pointer to the parent node
+ * @avl_link: pointer to the left/right pointer of @parent
+ *
+ * A new leaf is always the direct neighbor of its parent. The list is
+ * therefore updated without any search.
+ *
+ * WARNING avl_insert_balance has to be called afterwards for &node->avl
+ */
+static __inline__ void avl_list_link_node(struct avl_list_node *node,
+					    struct avl_node *parent,
+					    struct avl_node **avl_link)
+{
+	struct avl_list_node *list_parent;
+
+	node->prev = NULL;
+	node->next = NULL;
+
+	if (parent) {
+		list_parent = container_of(parent, struct avl_list_node, avl);
+
+		if (avl_link == &parent->left) {
+			node->prev = list_parent->prev;
+			node->next = list_parent;
+		} else {
+			node->prev = list_parent;
+			node->next = list_parent->next;
+		}
+
+		if (node->prev)
+			node->prev->next = node;
+		if (node->next)
+			node->next->prev = node;
+	}
+
+	avl_link_node(&node->avl, parent, avl_link);
+}
+
+/**
+ * avl_list_insert() - Add new listed node as new leaf and rebalance tree
+ * @node: pointer to the new node
+ * @parent: pointer to the parent node
+ * @avl_link: pointer to the left/right pointer of @parent
+ * @root: pointer to avl root
+ */
+static __inline__ void avl_list_insert(struct avl_list_node *node,
+					 struct avl_node *parent,
+					 struct avl_node **avl_link,
+					 struct avl_root *root)
+{
+	avl_list_link_node(node, parent, avl_link);
+	avl_insert_balance(&node->avl, root);
+}
+
+/**
+ * avl_list_erase() - Remove listed node from tree and list and rebalance tree
+ * @node: pointer to the node
+ * @root: pointer to avl root
+ */
+static __inline__ void avl_list_erase(struct avl_list_node *node,
+					struct avl_root *root)
+{
+	if (node->prev)
+		node->prev->next = node->next;
+	if (node->next)
+		node->next->prev = node->prev;
+
+	avl_erase(&node->avl, root);
+}
+
+/**
+ * avl_list_next() - Get in-order successor of listed node
+ * @node: pointer to the node
+ *
+ * Return: next listed node, NULL when @node is the last node
+ */
+static __inline__ struct avl_list_node *
+avl_list_next(const struct avl_list_node *node)
+{
+	return node->next;
+}
+
+/**
+ * avl_list_prev() - Get in-order predecessor of listed node
+ * @node: pointer to the node
+ *
+ * Return: previous listed node, NULL when @node is the first node
+ */
+static __inline__ struct avl_list_node *
+avl_list_prev(const struct avl_list_node *node)
+{
+	return node->prev;
+}
+
+/**
+ * struct avl_epoch_entry - object waiting for deferred free
+ * @next: next retired object
+ * @epoch: epoch in which the object was retired
+ * @free_cb: function which frees the object
+ *
+ * The entry is usually embedded next to the avl node in the entry of the tree.
+ */
+struct avl_epoch_entry {
+	struct avl_epoch_entry *next;
+	unsigned long epoch;
+	void (*free_cb)(struct avl_epoch_entry *entry);
+};
+
+/**
+ * struct avl_epoch_reader - reader registered at an avl_epoch
+ * @next: next registered reader
+ * @state: epoch seen at avl_epoch_enter shifted by one, lowest bit is set
+ *  while the reader is active
+ */
+struct avl_epoch_reader {
+	struct avl_epoch_reader *next;
+	unsigned long state;
+};
+
+/**
+ * struct avl_epoch - epoch based reclamation for lockless tree readers
+ * @epoch: current global epoch
+ * @readers: list of registered readers
+ * @retired: list of objects waiting for deferred free
+ *
+ * Readers of a tree (for example of an avl_root_seq) may still access an
+ * entry after it was erased. The writer therefore retires the entry with
+ * avl_epoch_retire instead of freeing it. avl_epoch_reclaim frees it only after
+ * all readers which were active during the erase left their read section.
+ *
+ * avl_first, avl_last, avl_next and avl_prev can be used inside a read
+ * section when AVLTREE_LOCKLESS_READERS is defined. They never access free'd
+ * memory but may skip or repeat entries when the tree is modified
+ * concurrently. An avl_root_seq can be used to detect this.
+ *
+ * All functions except avl_epoch_enter and avl_epoch_exit must be serialized
+ * with the writers of the tree.
+ */
+struct avl_epoch {
+	unsigned long epoch;
+	struct avl_epoch_reader *readers;
+	struct avl_epoch_entry *retired;
+};
+
+/**
+ * DEFINE_AVL_EPOCH - define epoch reclamation object and initialize it
+ * @epoch: name of the new object
+ */
+#define DEFINE_AVL_EPOCH(epoch) \
+	struct avl_epoch epoch = { 0, NULL, NULL }
+
+/**
+ * INIT_AVL_EPOCH() - Initialize epoch reclamation without readers
+ * @epoch: pointer to epoch reclamation object
+ */
+static __inline__ void INIT_AVL_EPOCH(struct avl_epoch *epoch)
+{
+	epoch->epoch = 0;
+	epoch->readers = NULL;
+	epoch->retired = NULL;
+}
+
+/**
+ * avl_epoch_enter() - Start read section
+ * @epoch: pointer to epoch reclamation object
+ * @reader: registered reader starting the read section
+ *
+ * Read sections of the same reader must not be nested.
+ */
+static __inline__ void avl_epoch_enter(const struct avl_epoch *epoch,
+				       struct avl_epoch_reader *reader)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	unsigned long current = __atomic_load_n(&epoch->epoch,
+						__ATOMIC_RELAXED);
+
+	__atomic_store_n(&reader->state, (current << 1) | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+	*(volatile unsigned long *)&reader->state = (epoch->epoch << 1) | 1;
+#endif
+}
+
+/**
+ * avl_epoch_exit() - Finish read section
+ * @reader: registered reader finishing the read section
+ *
+ * No node or entry found during the read section must be accessed afterwards.
+ */
+static __inline__ void avl_epoch_exit(struct avl_epoch_reader *reader)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_store_n(&reader->state, 0, __ATOMIC_RELEASE);
+#else
+	*(volatile unsigned long *)&reader->state = 0;
+#endif
+}
+
+void avl_epoch_register(struct avl_epoch *epoch,
+			struct avl_epoch_reader *reader);
+void avl_epoch_unregister(struct avl_epoch *epoch,
+			  struct avl_epoch_reader *reader);
+void avl_epoch_retire(struct avl_epoch *epoch, struct avl_epoch_entry *entry,
+		      void (*free_cb)(struct avl_epoch_entry *entry));
+size_t avl_epoch_reclaim(struct avl_epoch *epoch);
+
 /**
  * avl_entry() - Calculate address of entry that contains tree node
  * @node: pointer to tree node
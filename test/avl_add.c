@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem duplicates[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root root;
+	struct avl_node *node;
+	struct avlitem *item;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avl_add(&items[j].avl, &root, avlitem_cmp);
+			skiplist[values[j]] = 0;
+
+			check_root_order(&root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			check_depth(&root);
+		}
+
+		/* equal keys are added after the existing nodes */
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			duplicates[j].i = values[j];
+			avl_add(&duplicates[j].avl, &root, avlitem_cmp);
+		}
+		check_depth(&root);
+
+		for (node = avl_first(&root), j = 0; node;
+		     node = avl_next(node), j++) {
+			item = avl_entry(node, struct avlitem, avl);
+			assert(item->i == j / 2);
+
+			if (j % 2)
+				assert(item == &duplicates[item - duplicates]);
+			else
+				assert(item == &items[item - items]);
+		}
+		assert(j == 2 * ARRAY_SIZE(values));
+	}
+
+	return 0;
+}
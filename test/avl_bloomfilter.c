@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bloomfilter.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static uint8_t counters[16 * ARRAY_SIZE(values)];
+
+static void check_filter(struct avl_bloomtree *tree)
+{
+	struct avlitem *item;
+	size_t j;
+
+	check_root_order(&tree->root, skiplist,
+			 (uint16_t)ARRAY_SIZE(skiplist));
+	check_depth(&tree->root);
+
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		item = avl_bloomtree_find(tree, (uint16_t)j);
+		assert(item == avlitem_find(&tree->root, (uint16_t)j));
+
+		/* no false negatives */
+		if (!skiplist[j])
+			assert(avl_bloomtree_maybe(tree, (uint16_t)j));
+	}
+}
+
+int main(void)
+{
+	struct avl_bloomtree tree;
+	size_t misses;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		avl_bloomtree_init(&tree, counters, ARRAY_SIZE(counters));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			/* only even keys, odd keys are never found */
+			if (values[j] % 2)
+				continue;
+
+			items[j].i = values[j];
+			avl_bloomtree_insert(&tree, &items[j]);
+			skiplist[values[j]] = 0;
+		}
+		check_filter(&tree);
+
+		/* most of the misses are detected by the filter alone */
+		misses = 0;
+		for (j = 1; j < ARRAY_SIZE(values); j += 2) {
+			if (!avl_bloomtree_maybe(&tree, (uint16_t)j))
+				misses++;
+		}
+		assert(misses > ARRAY_SIZE(values) / 4);
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			if (values[j] % 2)
+				continue;
+
+			avl_bloomtree_erase(&tree, &items[j]);
+			skiplist[values[j]] = 1;
+
+			if (j % 16 == 0)
+				check_filter(&tree);
+		}
+		check_filter(&tree);
+
+		/* counters are back at zero after all nodes were removed */
+		for (j = 0; j < ARRAY_SIZE(counters); j++)
+			assert(counters[j] == 0);
+	}
+
+	return 0;
+}
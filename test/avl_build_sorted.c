@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static struct avlitem items[256];
+static struct avl_node *nodes[ARRAY_SIZE(items)];
+static uint8_t skiplist[ARRAY_SIZE(items)];
+
+int main(void)
+{
+	struct avl_root root;
+	size_t i, j;
+
+	for (i = 0; i <= ARRAY_SIZE(items); i++) {
+		memset(skiplist, 1, sizeof(skiplist));
+
+		for (j = 0; j < i; j++) {
+			items[j].i = (uint16_t)j;
+			nodes[j] = &items[j].avl;
+			skiplist[j] = 0;
+		}
+
+		INIT_AVL_ROOT(&root);
+		avl_build_sorted(&root, nodes, i);
+		assert(avl_empty(&root) == (i == 0));
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+
+		/* tree must still work with normal operations */
+		for (j = 0; j < i; j += 3) {
+			avl_erase(&items[j].avl, &root);
+			skiplist[j] = 1;
+		}
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+	}
+
+	return 0;
+}
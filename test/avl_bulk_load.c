@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avl_node *nodes[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root root;
+	size_t i, j, n;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		n = get_unsigned16() % (ARRAY_SIZE(values) + 1);
+		for (j = 0; j < n; j++) {
+			items[j].i = values[j];
+			nodes[j] = &items[j].avl;
+			skiplist[values[j]] = 0;
+		}
+
+		INIT_AVL_ROOT(&root);
+		avl_bulk_load(&root, nodes, n, avlitem_cmp);
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+
+		for (j = 0; j < n; j++)
+			assert(avlitem_find(&root, values[j]) == &items[j]);
+	}
+
+	return 0;
+}
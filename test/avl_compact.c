@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+struct lazyitem {
+	uint16_t i;
+	struct avl_lazy_node lazy;
+};
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+static uint8_t dropped[ARRAY_SIZE(values)];
+
+static struct lazyitem items[ARRAY_SIZE(values)];
+
+static void lazyitem_insert(struct avl_root_lazy *root,
+			    struct lazyitem *new_entry)
+{
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodep = &root->root.node;
+	struct lazyitem *cur_entry;
+
+	while (*cur_nodep) {
+		cur_entry = avl_entry(*cur_nodep, struct lazyitem, lazy.avl);
+
+		parent = *cur_nodep;
+		if (cmpint(&new_entry->i, &cur_entry->i) < 0)
+			cur_nodep = &((*cur_nodep)->left);
+		else
+			cur_nodep = &((*cur_nodep)->right);
+	}
+
+	avl_lazy_insert(&new_entry->lazy, parent, cur_nodep, root);
+}
+
+static void drop_item(struct avl_node *node)
+{
+	struct lazyitem *item = avl_entry(node, struct lazyitem, lazy.avl);
+
+	assert(item->lazy.dead);
+	assert(!dropped[item->i]);
+	dropped[item->i] = 1;
+}
+
+static void check_tree(struct avl_root_lazy *root)
+{
+	struct avl_node *node;
+	struct lazyitem *item;
+	size_t pos = 0;
+	size_t cnt = 0;
+
+	for (node = avl_first(&root->root); node; node = avl_next(node)) {
+		item = avl_entry(node, struct lazyitem, lazy.avl);
+
+		while (pos < ARRAY_SIZE(skiplist) && skiplist[pos])
+			pos++;
+		assert(item->i == pos);
+		assert(!item->lazy.dead);
+		pos++;
+		cnt++;
+	}
+
+	assert(root->count == cnt);
+	assert(root->dead == 0);
+	check_depth(&root->root);
+}
+
+int main(void)
+{
+	struct avl_root_lazy root;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+		memset(dropped, 0, sizeof(dropped));
+
+		INIT_AVL_ROOT_LAZY(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			lazyitem_insert(&root, &items[j]);
+		}
+
+		/* nothing to compact */
+		avl_compact(&root, drop_item);
+		check_tree(&root);
+
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			avl_mark_deleted(&items[values[j]].lazy, &root);
+			skiplist[items[values[j]].i] = 1;
+
+			if (!avl_compact_due(&root, (unsigned int)(i % 100)))
+				continue;
+
+			avl_compact(&root, drop_item);
+			check_tree(&root);
+		}
+
+		avl_compact(&root, drop_item);
+		check_tree(&root);
+		assert(avl_empty(&root.root));
+
+		for (j = 0; j < ARRAY_SIZE(values); j++)
+			assert(dropped[j]);
+	}
+
+	return 0;
+}
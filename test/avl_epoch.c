@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* pthread_join with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+struct epochitem {
+	struct avlitem item;
+	struct avl_epoch_entry epoch;
+};
+
+static uint16_t values[256];
+static uint16_t delete_items[ARRAY_SIZE(values)];
+static size_t freed;
+
+static void epochitem_free(struct avl_epoch_entry *entry)
+{
+	struct epochitem *eitem;
+
+	eitem = container_of(entry, struct epochitem, epoch);
+	free(eitem);
+	freed++;
+}
+
+#ifdef AVLTREE_ATOMIC_LINKS
+static struct epochitem *concurrent_live[ARRAY_SIZE(values)];
+static struct avl_epoch concurrent_epoch;
+static struct avl_root concurrent_root;
+static int concurrent_stop;
+
+static void *concurrent_reader(void *arg)
+{
+	struct avl_epoch_reader *reader = (struct avl_epoch_reader *)arg;
+	struct avlitem *item;
+	struct avl_node *node;
+	size_t steps;
+
+	while (!__atomic_load_n(&concurrent_stop, __ATOMIC_RELAXED)) {
+		avl_epoch_enter(&concurrent_epoch, reader);
+
+		/* entries can be skipped or repeated but never be free'd */
+		node = avl_first(&concurrent_root);
+		for (steps = 0; node && steps < 4 * ARRAY_SIZE(values);
+		     steps++) {
+			item = avl_entry(node, struct avlitem, avl);
+			assert(item->i < ARRAY_SIZE(values));
+
+			node = avl_next(node);
+		}
+
+		avl_epoch_exit(reader);
+	}
+
+	return NULL;
+}
+
+static struct epochitem *concurrent_alloc(void)
+{
+	struct epochitem *eitem;
+
+	eitem = (struct epochitem *)malloc(sizeof(*eitem));
+	assert(eitem);
+
+	eitem->item.i = get_unsigned16() % ARRAY_SIZE(values);
+	avlitem_insert_balanced(&concurrent_root, &eitem->item);
+
+	return eitem;
+}
+
+static void check_concurrent_reader(void)
+{
+	struct avl_epoch_reader reader;
+	struct epochitem *eitem;
+	pthread_t thread;
+	size_t retired = 0;
+	size_t pos;
+	size_t j;
+	int ret;
+
+	INIT_AVL_ROOT(&concurrent_root);
+	INIT_AVL_EPOCH(&concurrent_epoch);
+	avl_epoch_register(&concurrent_epoch, &reader);
+	freed = 0;
+
+	for (j = 0; j < ARRAY_SIZE(concurrent_live); j++)
+		concurrent_live[j] = concurrent_alloc();
+
+	__atomic_store_n(&concurrent_stop, 0, __ATOMIC_RELAXED);
+	ret = pthread_create(&thread, NULL, concurrent_reader, &reader);
+	assert(ret == 0);
+
+	/* writer replaces random entries while the reader walks the tree */
+	for (j = 0; j < 100000; j++) {
+		pos = get_unsigned16() % ARRAY_SIZE(concurrent_live);
+		eitem = concurrent_live[pos];
+
+		avl_erase(&eitem->item.avl, &concurrent_root);
+		avl_epoch_retire(&concurrent_epoch, &eitem->epoch,
+				 epochitem_free);
+		retired++;
+
+		concurrent_live[pos] = concurrent_alloc();
+		avl_epoch_reclaim(&concurrent_epoch);
+	}
+
+	__atomic_store_n(&concurrent_stop, 1, __ATOMIC_RELAXED);
+	ret = pthread_join(thread, NULL);
+	assert(ret == 0);
+	(void)ret;
+
+	check_depth(&concurrent_root);
+
+	for (j = 0; j < ARRAY_SIZE(concurrent_live); j++) {
+		eitem = concurrent_live[j];
+		avl_erase(&eitem->item.avl, &concurrent_root);
+		avl_epoch_retire(&concurrent_epoch, &eitem->epoch,
+				 epochitem_free);
+		retired++;
+	}
+
+	avl_epoch_reclaim(&concurrent_epoch);
+	avl_epoch_reclaim(&concurrent_epoch);
+	assert(freed == retired);
+
+	avl_epoch_unregister(&concurrent_epoch, &reader);
+}
+#endif
+
+int main(void)
+{
+	struct avl_epoch_reader reader1;
+	struct avl_epoch_reader reader2;
+	struct epochitem *eitem;
+	struct avl_epoch epoch;
+	struct avl_root root;
+	struct avlitem *item;
+	struct avl_node *node;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		INIT_AVL_ROOT(&root);
+		INIT_AVL_EPOCH(&epoch);
+		avl_epoch_register(&epoch, &reader1);
+		avl_epoch_register(&epoch, &reader2);
+		freed = 0;
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			eitem = (struct epochitem *)malloc(sizeof(*eitem));
+			assert(eitem);
+
+			eitem->item.i = values[j];
+			avlitem_insert_balanced(&root, &eitem->item);
+		}
+
+		/* reader1 holds the first node while everything is erased */
+		avl_epoch_enter(&epoch, &reader1);
+		node = avl_first(&root);
+		assert(node);
+
+		random_shuffle_array(delete_items, (uint16_t)ARRAY_SIZE(delete_items));
+		for (j = 0; j < ARRAY_SIZE(delete_items); j++) {
+			/* unrelated read sections don't block reclamation */
+			avl_epoch_enter(&epoch, &reader2);
+			item = avlitem_find(&root, delete_items[j]);
+			assert(item);
+			avl_epoch_exit(&reader2);
+
+			avl_erase(&item->avl, &root);
+			eitem = container_of(item, struct epochitem, item);
+			avl_epoch_retire(&epoch, &eitem->epoch, epochitem_free);
+
+			check_depth(&root);
+			avl_epoch_reclaim(&epoch);
+			assert(freed == 0);
+		}
+		assert(avl_empty(&root));
+
+		/* walk over erased (old) structure is still possible */
+		for (j = 0; node; j++, node = avl_next(node)) {
+			item = avl_entry(node, struct avlitem, avl);
+			assert(item->i < ARRAY_SIZE(values));
+		}
+		assert(j <= ARRAY_SIZE(values));
+		avl_epoch_exit(&reader1);
+
+		avl_epoch_reclaim(&epoch);
+		avl_epoch_reclaim(&epoch);
+		assert(freed == ARRAY_SIZE(values));
+		assert(avl_epoch_reclaim(&epoch) == 0);
+
+		/* entries retired without readers are free'd after two epochs */
+		eitem = (struct epochitem *)malloc(sizeof(*eitem));
+		assert(eitem);
+		avl_epoch_retire(&epoch, &eitem->epoch, epochitem_free);
+		assert(avl_epoch_reclaim(&epoch) == 0);
+		assert(avl_epoch_reclaim(&epoch) == 1);
+
+		avl_epoch_unregister(&epoch, &reader1);
+		avl_epoch_unregister(&epoch, &reader2);
+		assert(!epoch.readers);
+	}
+
+#ifdef AVLTREE_ATOMIC_LINKS
+	check_concurrent_reader();
+#endif
+
+	return 0;
+}
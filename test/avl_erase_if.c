@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+static uint8_t expire[ARRAY_SIZE(values)];
+static size_t dropped;
+
+static bool item_expired(const struct avl_node *node, void *priv)
+{
+	const struct avlitem *item = avl_entry(node, const struct avlitem, avl);
+	const unsigned int *threshold = (const unsigned int *)priv;
+
+	return expire[item->i] < *threshold;
+}
+
+static void drop_item(struct avl_node *node)
+{
+	struct avlitem *item = avl_entry(node, struct avlitem, avl);
+
+	assert(!skiplist[item->i]);
+	skiplist[item->i] = 1;
+	dropped++;
+	free(item);
+}
+
+int main(void)
+{
+	struct avl_root root;
+	struct avlitem *item;
+	unsigned int threshold;
+	size_t i, j;
+	size_t remaining;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			item = (struct avlitem *)malloc(sizeof(*item));
+			assert(item);
+
+			item->i = values[j];
+			expire[values[j]] = (uint8_t)get_unsigned16();
+			avlitem_insert_balanced(&root, item);
+		}
+
+		remaining = ARRAY_SIZE(values);
+		for (threshold = 0; threshold < 255; threshold += 1 + i % 64) {
+			dropped = 0;
+			avl_erase_if(&root, item_expired, &threshold,
+				     drop_item);
+
+			for (j = 0; j < ARRAY_SIZE(values); j++)
+				assert(skiplist[j] == (expire[j] < threshold));
+
+			assert(dropped <= remaining);
+			remaining -= dropped;
+
+			check_root_order(&root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			check_depth(&root);
+		}
+
+		threshold = 255;
+		avl_erase_if(&root, item_expired, &threshold, drop_item);
+		while (!avl_empty(&root)) {
+			item = avl_entry(root.node, struct avlitem, avl);
+			avl_erase(&item->avl, &root);
+			free(item);
+		}
+	}
+
+	return 0;
+}
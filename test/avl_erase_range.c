@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+static uint8_t dropped[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+static void drop_item(struct avl_node *node)
+{
+	struct avlitem *item = avl_entry(node, struct avlitem, avl);
+
+	assert(!dropped[item->i]);
+	dropped[item->i] = 1;
+}
+
+int main(void)
+{
+	struct avl_root root;
+	struct avlitem *first;
+	struct avlitem *last;
+	uint16_t from, to;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+		memset(dropped, 0, sizeof(dropped));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avlitem_insert_balanced(&root, &items[j]);
+		}
+
+		/* remove multiple random ranges until the tree is empty */
+		while (!avl_empty(&root)) {
+			from = get_unsigned16() % ARRAY_SIZE(values);
+			while (skiplist[from])
+				from = (from + 1) % ARRAY_SIZE(values);
+
+			to = from + get_unsigned16() % (1 + i % 64);
+			if (to >= ARRAY_SIZE(values))
+				to = ARRAY_SIZE(values) - 1;
+
+			while (skiplist[to])
+				to--;
+
+			first = avlitem_find(&root, from);
+			last = avlitem_find(&root, to);
+			assert(first && last);
+
+			avl_erase_range(&root, &first->avl, &last->avl,
+					drop_item);
+
+			for (j = from; j <= to; j++) {
+				assert(dropped[j]);
+				skiplist[j] = 1;
+			}
+
+			check_root_order(&root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			check_depth(&root);
+		}
+
+		for (j = 0; j < ARRAY_SIZE(values); j++)
+			assert(dropped[j]);
+	}
+
+	return 0;
+}
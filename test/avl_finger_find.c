@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+
+static uint16_t values[256];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem key;
+static size_t compares;
+
+static int avlitem_cmp_count(const struct avl_node *a,
+			     const struct avl_node *b)
+{
+	compares++;
+
+	return avlitem_cmp(a, b);
+}
+
+int main(void)
+{
+	struct avl_node *finger;
+	struct avl_root root;
+	struct avl_node *node;
+	struct avlitem *item;
+	size_t i, j;
+
+	INIT_AVL_ROOT(&root);
+	finger = NULL;
+	key.i = 0;
+	assert(!avl_finger_find(&root, &finger, &key.avl, avlitem_cmp));
+	assert(!finger);
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		/* only even keys are in the tree */
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = (uint16_t)(values[j] * 2);
+			avlitem_insert_balanced(&root, &items[j]);
+		}
+
+		/* a hit at the root must also set the finger */
+		finger = NULL;
+		key.i = avl_entry(root.node, struct avlitem, avl)->i;
+		node = avl_finger_find(&root, &finger, &key.avl, avlitem_cmp);
+		assert(node == root.node);
+		assert(finger == root.node);
+
+		/* keys next to the finger need at most two compares */
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			finger = &items[j].avl;
+			key.i = (uint16_t)(items[j].i +
+					   get_unsigned16() % 5 - 2);
+			if (key.i >= 2 * ARRAY_SIZE(values))
+				continue;
+
+			compares = 0;
+			node = avl_finger_find(&root, &finger, &key.avl,
+					       avlitem_cmp_count);
+			assert(compares <= 2);
+
+			if (key.i % 2) {
+				assert(!node);
+				item = avl_entry(finger, struct avlitem, avl);
+				assert(item->i == key.i - 1 ||
+				       item->i == key.i + 1);
+			} else {
+				assert(node);
+				assert(finger == node);
+				item = avl_entry(node, struct avlitem, avl);
+				assert(item->i == key.i);
+			}
+		}
+
+		finger = NULL;
+		key.i = (uint16_t)(get_unsigned16() % (2 * ARRAY_SIZE(values)));
+		for (j = 0; j < 4 * ARRAY_SIZE(values); j++) {
+			/* mostly local steps with a few far jumps */
+			if (j % 16 == 0)
+				key.i = (uint16_t)(get_unsigned16() %
+						   (2 * ARRAY_SIZE(values)));
+			else
+				key.i = (uint16_t)((key.i + get_unsigned16() % 9 +
+						    2 * ARRAY_SIZE(values) - 4) %
+						   (2 * ARRAY_SIZE(values)));
+
+			node = avl_finger_find(&root, &finger, &key.avl,
+					       avlitem_cmp);
+			item = avlitem_find(&root, key.i);
+
+			if (key.i % 2) {
+				assert(!node);
+				assert(!item);
+
+				/* finger is a direct neighbor of the key */
+				item = avl_entry(finger, struct avlitem, avl);
+				assert(item->i == key.i - 1 ||
+				       item->i == key.i + 1);
+			} else {
+				assert(node == &item->avl);
+				assert(finger == node);
+			}
+		}
+	}
+
+	return 0;
+}
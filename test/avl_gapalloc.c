@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-gapalloc.h"
+#include "common-treevalidation.h"
+
+static uint8_t allocated[256];
+
+static struct avl_extent extents[ARRAY_SIZE(allocated)];
+
+static uint64_t check_max_gap(const struct avl_node *node)
+{
+	const struct avl_extent *extent;
+	uint64_t max_gap;
+	uint64_t child_gap;
+
+	if (!node)
+		return 0;
+
+	extent = avl_entry(node, const struct avl_extent, avl);
+	max_gap = extent->gap;
+
+	child_gap = check_max_gap(node->left);
+	if (child_gap > max_gap)
+		max_gap = child_gap;
+
+	child_gap = check_max_gap(node->right);
+	if (child_gap > max_gap)
+		max_gap = child_gap;
+
+	assert(extent->max_gap == max_gap);
+
+	return max_gap;
+}
+
+static void check_gaps(const struct avl_gapalloc *alloc)
+{
+	const struct avl_extent *extent;
+	struct avl_node *node;
+	uint64_t end = 0;
+
+	for (node = avl_first(&alloc->root); node; node = avl_next(node)) {
+		extent = avl_entry(node, const struct avl_extent, avl);
+
+		assert(extent->start >= end);
+		assert(extent->gap == extent->start - end);
+		end = extent->start + extent->len;
+	}
+
+	assert(end <= alloc->size);
+
+	check_max_gap(alloc->root.node);
+	check_depth(&alloc->root);
+}
+
+/* first-fit by linear scan over all extents */
+static bool linear_first_fit(const struct avl_gapalloc *alloc, uint64_t len,
+			     uint64_t *start)
+{
+	const struct avl_extent *extent;
+	struct avl_node *node;
+	uint64_t end = 0;
+
+	for (node = avl_first(&alloc->root); node; node = avl_next(node)) {
+		extent = avl_entry(node, const struct avl_extent, avl);
+
+		if (extent->start - end >= len) {
+			*start = end;
+			return true;
+		}
+
+		end = extent->start + extent->len;
+	}
+
+	if (alloc->size - end < len)
+		return false;
+
+	*start = end;
+	return true;
+}
+
+int main(void)
+{
+	struct avl_gapalloc alloc;
+	uint64_t expected_start;
+	bool expected;
+	uint64_t len;
+	size_t i, j;
+	uint16_t pos;
+
+	for (i = 0; i < 256; i++) {
+		memset(allocated, 0, sizeof(allocated));
+		avl_gapalloc_init(&alloc, 2048 + 64 * i);
+
+		for (j = 0; j < 1024; j++) {
+			pos = get_unsigned16() % ARRAY_SIZE(allocated);
+
+			if (allocated[pos]) {
+				avl_gapalloc_free(&alloc, &extents[pos]);
+				allocated[pos] = 0;
+				check_gaps(&alloc);
+				continue;
+			}
+
+			len = 1 + get_unsigned16() % 64;
+			expected = linear_first_fit(&alloc, len,
+						    &expected_start);
+
+			allocated[pos] = avl_gapalloc_alloc(&alloc,
+							    &extents[pos],
+							    len);
+			assert(allocated[pos] == expected);
+			if (expected) {
+				assert(extents[pos].start == expected_start);
+				assert(extents[pos].len == len);
+			}
+
+			check_gaps(&alloc);
+		}
+
+		/* freeing everything coalesces the whole space */
+		for (j = 0; j < ARRAY_SIZE(allocated); j++) {
+			if (!allocated[j])
+				continue;
+
+			avl_gapalloc_free(&alloc, &extents[j]);
+			check_gaps(&alloc);
+		}
+
+		assert(avl_empty(&alloc.root));
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-hashindex.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem replacements[ARRAY_SIZE(values)];
+static struct avl_node *slots[2 * ARRAY_SIZE(values)];
+
+static void check_index(struct avl_hashindex *index)
+{
+	struct avlitem *item;
+	size_t j;
+
+	check_root_order(&index->root, skiplist,
+			 (uint16_t)ARRAY_SIZE(skiplist));
+	check_depth(&index->root);
+
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		item = avl_hashindex_find(index, (uint16_t)j);
+		assert(item == avlitem_find(&index->root, (uint16_t)j));
+
+		if (skiplist[j])
+			assert(!item);
+		else
+			assert(item && item->i == j);
+	}
+}
+
+int main(void)
+{
+	struct avl_hashindex index;
+	struct avlitem *item;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		avl_hashindex_init(&index, slots, ARRAY_SIZE(slots));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avl_hashindex_insert(&index, &items[j]);
+			skiplist[values[j]] = 0;
+		}
+		check_index(&index);
+
+		/* replace some nodes with new nodes using the same key */
+		for (j = 0; j < ARRAY_SIZE(values); j += 1 + i % 8) {
+			replacements[j].i = items[j].i;
+			avl_hashindex_replace(&index, &items[j],
+					      &replacements[j]);
+		}
+		check_index(&index);
+
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			item = avl_hashindex_find(&index, values[j]);
+			assert(item);
+
+			avl_hashindex_erase(&index, item);
+			skiplist[values[j]] = 1;
+
+			if (j % 16 == 0)
+				check_index(&index);
+		}
+		check_index(&index);
+	}
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem duplicates[ARRAY_SIZE(values)];
+static struct avl_node *nodes[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root root;
+	struct avl_node *node;
+	struct avlitem *item;
+	uint16_t last;
+	size_t i, j, n;
+	size_t batch;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		/* alternate between small batches and batches larger than tree */
+		if (i % 2)
+			batch = 1 + get_unsigned16() % 16;
+		else
+			batch = get_unsigned16() % ARRAY_SIZE(values);
+
+		INIT_AVL_ROOT(&root);
+		for (j = batch; j < ARRAY_SIZE(values); j++) {
+			items[values[j]].i = values[j];
+			avlitem_insert_balanced(&root, &items[values[j]]);
+			skiplist[values[j]] = 0;
+		}
+
+		n = 0;
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			if (!skiplist[j])
+				continue;
+
+			items[j].i = (uint16_t)j;
+			nodes[n++] = &items[j].avl;
+			skiplist[j] = 0;
+		}
+		assert(n == batch);
+
+		avl_insert_batch(&root, nodes, n, avlitem_cmp);
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+
+		/* batch with keys which are already in the tree */
+		n = 0;
+		for (j = 0; j < ARRAY_SIZE(values); j += 1 + i % 5) {
+			duplicates[j].i = (uint16_t)j;
+			nodes[n++] = &duplicates[j].avl;
+		}
+
+		avl_insert_batch(&root, nodes, n, avlitem_cmp);
+		check_depth(&root);
+
+		last = 0;
+		for (node = avl_first(&root), j = 0; node;
+		     node = avl_next(node), j++) {
+			item = avl_entry(node, struct avlitem, avl);
+			assert(item->i >= last);
+
+			/* duplicates must be inserted after the old nodes */
+			if (item == &duplicates[item->i])
+				assert(j > 0 && item->i == last);
+
+			last = item->i;
+		}
+		assert(j == ARRAY_SIZE(values) + n);
+	}
+
+	return 0;
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-setops.h"
+#include "common-treeops.h"
+
+static bool intersect_keep(bool in_b)
+{
+	return in_b;
+}
+
+static void check_intersect(struct avl_root *a, struct avl_root *b)
+{
+	avl_intersect(a, b, avlitem_cmp, setops_drop);
+	setops_check_filter(a, b, intersect_keep);
+}
+
+int main(void)
+{
+	struct avl_root a;
+	struct avl_root b;
+	size_t i;
+
+	for (i = 0; i < 256; i++) {
+		setops_prepare(&a, &b, (unsigned int)i);
+		check_intersect(&a, &b);
+	}
+
+	for (i = 0; i < 16; i++) {
+		setops_prepare_case(&a, &b, SETOPS_EMPTY_A);
+		check_intersect(&a, &b);
+		assert(avl_empty(&a));
+
+		/* all nodes of a are removed without common keys */
+		setops_prepare_case(&a, &b, SETOPS_EMPTY_B);
+		check_intersect(&a, &b);
+		assert(avl_empty(&a));
+
+		setops_prepare_case(&a, &b, SETOPS_DISJOINT);
+		check_intersect(&a, &b);
+		assert(avl_empty(&a));
+
+		/* no node of a is removed when all keys are common */
+		setops_prepare_case(&a, &b, SETOPS_IDENTICAL);
+		check_intersect(&a, &b);
+
+		setops_prepare(&a, &b, (unsigned int)i);
+		check_intersect(&a, &a);
+		assert(!avl_empty(&a));
+	}
+
+	return 0;
+}
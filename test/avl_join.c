@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root left;
+	struct avl_root right;
+	struct avl_root root;
+	uint16_t pivot;
+	uint16_t first;
+	uint16_t last;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		/* random range [first, last] with pivot inside */
+		pivot = get_unsigned16() % ARRAY_SIZE(values);
+		first = get_unsigned16() % (pivot + 1);
+		last = pivot + get_unsigned16() % (ARRAY_SIZE(values) - pivot);
+
+		INIT_AVL_ROOT(&left);
+		INIT_AVL_ROOT(&right);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+
+			if (values[j] < first || values[j] > last)
+				continue;
+
+			skiplist[values[j]] = 0;
+
+			if (values[j] < pivot)
+				avlitem_insert_balanced(&left, &items[j]);
+			else if (values[j] > pivot)
+				avlitem_insert_balanced(&right, &items[j]);
+		}
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			if (values[j] == pivot)
+				break;
+		}
+		assert(j < ARRAY_SIZE(values));
+
+		if (i % 2) {
+			avl_join(&root, &left, &items[j].avl, &right);
+			assert(avl_empty(&left));
+		} else {
+			avl_join(&right, &left, &items[j].avl, &right);
+			root = right;
+		}
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+		assert(avlitem_find(&root, pivot) == &items[j]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+struct listitem {
+	uint16_t i;
+	struct avl_list_node list;
+};
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct listitem items[ARRAY_SIZE(values)];
+
+static void listitem_insert(struct avl_root *root, struct listitem *new_entry)
+{
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodeptr = &root->node;
+	struct listitem *cur_entry;
+
+	while (*cur_nodeptr) {
+		cur_entry = avl_entry(*cur_nodeptr, struct listitem,
+				      list.avl);
+
+		parent = *cur_nodeptr;
+		if (new_entry->i <= cur_entry->i)
+			cur_nodeptr = &((*cur_nodeptr)->left);
+		else
+			cur_nodeptr = &((*cur_nodeptr)->right);
+	}
+
+	avl_list_insert(&new_entry->list, parent, cur_nodeptr, root);
+}
+
+static void check_list(struct avl_root *root)
+{
+	struct avl_list_node *list = NULL;
+	struct avl_list_node *prev = NULL;
+	struct listitem *item;
+	struct avl_node *node;
+	size_t cnt = 0;
+	size_t j;
+
+	for (node = avl_first(root); node; node = avl_next(node)) {
+		item = avl_entry(node, struct listitem, list.avl);
+		list = &item->list;
+
+		assert(avl_list_prev(list) == prev);
+		if (prev)
+			assert(avl_list_next(prev) == list);
+
+		prev = list;
+		cnt++;
+	}
+
+	if (list)
+		assert(avl_list_next(list) == NULL);
+
+	/* walk backwards only via the list */
+	for (j = ARRAY_SIZE(skiplist); list; list = avl_list_prev(list)) {
+		item = avl_entry(list, struct listitem, list);
+
+		do {
+			j--;
+		} while (skiplist[j]);
+
+		assert(item->i == j);
+		cnt--;
+	}
+	assert(cnt == 0);
+}
+
+int main(void)
+{
+	struct avl_root root;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		INIT_AVL_ROOT(&root);
+		check_list(&root);
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			listitem_insert(&root, &items[j]);
+			skiplist[values[j]] = 0;
+		}
+		check_list(&root);
+
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			avl_list_erase(&items[values[j]].list, &root);
+			skiplist[items[values[j]].i] = 1;
+
+			if (j % 16 == 0)
+				check_list(&root);
+		}
+		check_list(&root);
+		assert(avl_empty(&root));
+	}
+
+	return 0;
+}
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+struct lazyitem {
+	uint16_t i;
+	struct avl_lazy_node lazy;
+};
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct lazyitem items[ARRAY_SIZE(values)];
+static struct lazyitem duplicates[ARRAY_SIZE(values)];
+
+static int lazyitem_cmp(const struct avl_node *a, const struct avl_node *b)
+{
+	const struct lazyitem *item_a;
+	const struct lazyitem *item_b;
+
+	item_a = avl_entry(a, const struct lazyitem, lazy.avl);
+	item_b = avl_entry(b, const struct lazyitem, lazy.avl);
+
+	return cmpint(&item_a->i, &item_b->i);
+}
+
+static void lazyitem_insert(struct avl_root_lazy *root,
+			    struct lazyitem *new_entry)
+{
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodep = &root->root.node;
+	struct lazyitem *cur_entry;
+
+	while (*cur_nodep) {
+		cur_entry = avl_entry(*cur_nodep, struct lazyitem, lazy.avl);
+
+		parent = *cur_nodep;
+		if (cmpint(&new_entry->i, &cur_entry->i) < 0)
+			cur_nodep = &((*cur_nodep)->left);
+		else
+			cur_nodep = &((*cur_nodep)->right);
+	}
+
+	avl_lazy_insert(&new_entry->lazy, parent, cur_nodep, root);
+}
+
+static void check_live(struct avl_root_lazy *root)
+{
+	struct avl_lazy_node *lazy;
+	struct lazyitem *item;
+	struct lazyitem key;
+	size_t pos = 0;
+
+	for (lazy = avl_lazy_first(root); lazy; lazy = avl_lazy_next(lazy)) {
+		item = avl_entry(lazy, struct lazyitem, lazy);
+
+		while (pos < ARRAY_SIZE(skiplist) && skiplist[pos])
+			pos++;
+		assert(pos < ARRAY_SIZE(skiplist));
+		assert(item->i == pos);
+		assert(!lazy->dead);
+		pos++;
+	}
+
+	while (pos < ARRAY_SIZE(skiplist) && skiplist[pos])
+		pos++;
+	assert(pos == ARRAY_SIZE(skiplist));
+
+	for (pos = 0; pos < ARRAY_SIZE(skiplist); pos++) {
+		key.i = (uint16_t)pos;
+		lazy = avl_lazy_find(root, &key.lazy.avl, lazyitem_cmp);
+
+		if (skiplist[pos]) {
+			assert(!lazy);
+		} else {
+			assert(lazy);
+			item = avl_entry(lazy, struct lazyitem, lazy);
+			assert(item->i == pos);
+		}
+	}
+}
+
+int main(void)
+{
+	struct avl_root_lazy root;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+
+		INIT_AVL_ROOT_LAZY(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			lazyitem_insert(&root, &items[j]);
+		}
+		assert(root.count == ARRAY_SIZE(values));
+
+		/* mark random nodes as deleted */
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			avl_mark_deleted(&items[values[j]].lazy, &root);
+			skiplist[items[values[j]].i] = 1;
+			assert(root.dead == j + 1);
+
+			/* marking a dead node again doesn't change the count */
+			if (j % 5 == 0) {
+				avl_mark_deleted(&items[values[j]].lazy, &root);
+				assert(root.dead == j + 1);
+			}
+
+			if (j % 32 == 0)
+				check_live(&root);
+
+			/* re-add some of the keys next to the dead nodes */
+			if (j % 7 == 0) {
+				duplicates[j].i = items[values[j]].i;
+				lazyitem_insert(&root, &duplicates[j]);
+				skiplist[duplicates[j].i] = 0;
+			}
+		}
+		check_live(&root);
+		check_depth(&root.root);
+	}
+
+	return 0;
+}
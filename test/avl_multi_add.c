@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+#define KEYS 16
+
+struct multiitem {
+	uint16_t key;
+	uint16_t i;
+	struct avl_multi_node multi;
+};
+
+static uint16_t values[256];
+static uint8_t removed[ARRAY_SIZE(values)];
+
+static struct multiitem items[ARRAY_SIZE(values)];
+
+static int multiitem_cmp(const struct avl_node *a, const struct avl_node *b)
+{
+	const struct multiitem *item_a;
+	const struct multiitem *item_b;
+
+	item_a = avl_entry(a, const struct multiitem, multi.avl);
+	item_b = avl_entry(b, const struct multiitem, multi.avl);
+
+	return cmpint(&item_a->key, &item_b->key);
+}
+
+static void check_multi(const struct avl_root *root)
+{
+	struct avl_multi_node *head;
+	struct avl_multi_node *dup;
+	struct multiitem *item;
+	struct multiitem key;
+	struct avl_node *node;
+	size_t expected;
+	size_t heads = 0;
+	size_t cnt;
+	uint16_t k;
+	size_t j;
+
+	check_depth(root);
+
+	for (k = 0; k < KEYS; k++) {
+		expected = 0;
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			if (!removed[j] && items[j].key == k)
+				expected++;
+		}
+
+		key.key = k;
+		head = avl_multi_find(root, &key.multi.avl, multiitem_cmp);
+		if (!expected) {
+			assert(!head);
+			continue;
+		}
+
+		/* chain is in insertion order */
+		assert(head);
+		heads++;
+		cnt = 0;
+		for (dup = head; dup; dup = avl_multi_next_dup(head, dup)) {
+			item = avl_entry(dup, struct multiitem, multi);
+			assert(item->key == k);
+			assert(!removed[item->i]);
+
+			if (dup != head)
+				assert(avl_entry(dup->prev, struct multiitem,
+						 multi)->i < item->i);
+			cnt++;
+		}
+		assert(cnt == expected);
+	}
+
+	/* only the heads are in the tree */
+	cnt = 0;
+	for (node = avl_first(root); node; node = avl_next(node))
+		cnt++;
+	assert(cnt == heads);
+}
+
+int main(void)
+{
+	struct avl_root root;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(removed, 0, sizeof(removed));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].key = values[j] % KEYS;
+			items[j].i = (uint16_t)j;
+			avl_multi_add(&items[j].multi, &root, multiitem_cmp);
+		}
+		check_multi(&root);
+
+		/* remove heads and chained entries in random order */
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			avl_multi_erase(&items[values[j]].multi, &root);
+			removed[values[j]] = 1;
+
+			if (j % 8 == 0)
+				check_multi(&root);
+		}
+		check_multi(&root);
+		assert(avl_empty(&root));
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+
+static uint16_t values[256];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avl_range parts[64];
+
+int main(void)
+{
+	struct avl_root root;
+	struct avl_node *node;
+	struct avl_node *end;
+	struct avlitem *item;
+	size_t nodes, max_nodes, nodes_tree;
+	uint32_t sum, total;
+	size_t count;
+	size_t i, j, k;
+
+	INIT_AVL_ROOT(&root);
+	assert(avl_partition(&root, parts, ARRAY_SIZE(parts)) == 0);
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		nodes_tree = ARRAY_SIZE(values) - i % 200;
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < nodes_tree; j++) {
+			items[j].i = values[j];
+			avlitem_insert_balanced(&root, &items[j]);
+		}
+
+		for (k = 1; k <= ARRAY_SIZE(parts); k++) {
+			count = avl_partition(&root, parts, k);
+			assert(count > 0);
+			assert(count <= k);
+			assert(parts[0].first == avl_first(&root));
+
+			/* map-reduce over all ranges */
+			total = 0;
+			max_nodes = 0;
+			for (j = 0; j < count; j++) {
+				end = avl_range_end(parts, count, j);
+				assert(parts[j].first != end);
+
+				nodes = 0;
+				sum = 0;
+				for (node = parts[j].first; node != end;
+				     node = avl_next(node)) {
+					item = avl_entry(node, struct avlitem, avl);
+					sum += item->i;
+					nodes++;
+				}
+
+				total += sum;
+				if (nodes > max_nodes)
+					max_nodes = nodes;
+			}
+
+			/* compare with sequential walk over the whole tree */
+			sum = 0;
+			for (node = avl_first(&root); node; node = avl_next(node))
+				sum += avl_entry(node, struct avlitem, avl)->i;
+			assert(total == sum);
+
+			/* ranges must have similar sizes */
+			if (count < k)
+				assert(max_nodes <= 2);
+			else
+				assert(max_nodes <= 4 * (nodes_tree / count) + 2);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+struct stritem {
+	struct avl_prefix_node node;
+	char name[24];
+};
+
+static uint16_t values[256];
+
+static struct stritem items[ARRAY_SIZE(values)];
+static size_t cmp_calls;
+
+static int stritem_cmp(const struct avl_node *a, const struct avl_node *b)
+{
+	const struct stritem *item_a;
+	const struct stritem *item_b;
+
+	item_a = avl_entry(a, const struct stritem, node.avl);
+	item_b = avl_entry(b, const struct stritem, node.avl);
+
+	cmp_calls++;
+
+	return strcmp(item_a->name, item_b->name);
+}
+
+/* odd numbers share a long common prefix, even numbers differ early */
+static void stritem_init(struct stritem *item, uint16_t x)
+{
+	if (x % 2)
+		sprintf(item->name, "common-prefix-%03u", (unsigned int)x);
+	else
+		sprintf(item->name, "%03u", (unsigned int)x);
+
+	item->node.prefix = avl_prefix_from_bytes(item->name,
+						  strlen(item->name));
+}
+
+static void check_sorted(const struct avl_root *root, size_t n)
+{
+	const struct stritem *last = NULL;
+	const struct stritem *item;
+	struct avl_node *node;
+	size_t cnt = 0;
+
+	for (node = avl_first(root); node; node = avl_next(node)) {
+		item = avl_entry(node, struct stritem, node.avl);
+
+		if (last)
+			assert(strcmp(last->name, item->name) < 0);
+
+		last = item;
+		cnt++;
+	}
+
+	assert(cnt == n);
+}
+
+int main(void)
+{
+	struct avl_prefix_node *found;
+	struct avl_root root;
+	struct stritem key;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			stritem_init(&items[j], values[j]);
+			avl_prefix_add(&items[j].node, &root, stritem_cmp);
+		}
+		check_sorted(&root, ARRAY_SIZE(values));
+		check_depth(&root);
+
+		for (j = 0; j < 2 * ARRAY_SIZE(values); j++) {
+			stritem_init(&key, (uint16_t)j);
+
+			cmp_calls = 0;
+			found = avl_prefix_find(&root, &key.node, stritem_cmp);
+
+			if (j < ARRAY_SIZE(values)) {
+				assert(found);
+				assert(strcmp(avl_entry(found, struct stritem,
+							node)->name,
+					      key.name) == 0);
+			} else {
+				assert(!found);
+			}
+
+			/* unique prefixes never need the full compare */
+			if (j % 2 == 0)
+				assert(cmp_calls <= 1);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+struct metric {
+	uint16_t key;
+	int32_t value;
+
+	/* aggregate of subtree */
+	int64_t sum;
+	int32_t min;
+	int32_t max;
+	uint16_t first;
+	uint16_t last;
+
+	struct avl_node avl;
+};
+
+struct metric_acc {
+	bool empty;
+	int64_t sum;
+	int32_t min;
+	int32_t max;
+	uint16_t last;
+};
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct metric metrics[ARRAY_SIZE(values)];
+
+static int metric_cmp(const struct avl_node *a, const struct avl_node *b)
+{
+	const struct metric *metric_a = avl_entry(a, const struct metric, avl);
+	const struct metric *metric_b = avl_entry(b, const struct metric, avl);
+
+	return cmpint(&metric_a->key, &metric_b->key);
+}
+
+static void metric_augment(struct avl_node *node)
+{
+	struct metric *metric = avl_entry(node, struct metric, avl);
+	const struct metric *child;
+
+	metric->sum = metric->value;
+	metric->min = metric->value;
+	metric->max = metric->value;
+	metric->first = metric->key;
+	metric->last = metric->key;
+
+	if (node->left) {
+		child = avl_entry(node->left, const struct metric, avl);
+		metric->sum += child->sum;
+		if (child->min < metric->min)
+			metric->min = child->min;
+		if (child->max > metric->max)
+			metric->max = child->max;
+		metric->first = child->first;
+	}
+
+	if (node->right) {
+		child = avl_entry(node->right, const struct metric, avl);
+		metric->sum += child->sum;
+		if (child->min < metric->min)
+			metric->min = child->min;
+		if (child->max > metric->max)
+			metric->max = child->max;
+		metric->last = child->last;
+	}
+}
+
+static void metric_combine(void *priv, const struct avl_node *node,
+			   bool subtree)
+{
+	const struct metric *metric = avl_entry(node, const struct metric, avl);
+	struct metric_acc *acc = (struct metric_acc *)priv;
+	int64_t sum = metric->value;
+	int32_t min = metric->value;
+	int32_t max = metric->value;
+	uint16_t first = metric->key;
+	uint16_t last = metric->key;
+
+	if (subtree) {
+		sum = metric->sum;
+		min = metric->min;
+		max = metric->max;
+		first = metric->first;
+		last = metric->last;
+	}
+
+	/* combine must be called in key order */
+	if (!acc->empty)
+		assert(acc->last < first);
+
+	if (acc->empty || min < acc->min)
+		acc->min = min;
+	if (acc->empty || max > acc->max)
+		acc->max = max;
+
+	acc->sum += sum;
+	acc->last = last;
+	acc->empty = false;
+}
+
+static void check_augment(const struct avl_node *node)
+{
+	struct metric expected;
+	const struct metric *metric;
+
+	if (!node)
+		return;
+
+	check_augment(node->left);
+	check_augment(node->right);
+
+	metric = avl_entry(node, const struct metric, avl);
+	expected = *metric;
+	metric_augment(&expected.avl);
+
+	assert(metric->sum == expected.sum);
+	assert(metric->min == expected.min);
+	assert(metric->max == expected.max);
+	assert(metric->first == expected.first);
+	assert(metric->last == expected.last);
+}
+
+static void metric_insert(struct avl_root *root, struct metric *new_entry)
+{
+	struct avl_node **cur_nodep = &root->node;
+	struct avl_node *parent = NULL;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		if (metric_cmp(&new_entry->avl, parent) < 0)
+			cur_nodep = &((*cur_nodep)->left);
+		else
+			cur_nodep = &((*cur_nodep)->right);
+	}
+
+	avl_link_node(&new_entry->avl, parent, cur_nodep);
+	avl_insert_augmented(&new_entry->avl, root, metric_augment);
+}
+
+static void check_range(const struct avl_root *root, uint16_t lo, uint16_t hi)
+{
+	static struct metric key_lo;
+	static struct metric key_hi;
+	struct metric_acc expected;
+	struct metric_acc acc;
+	size_t i;
+
+	key_lo.key = lo;
+	key_hi.key = hi;
+
+	memset(&acc, 0, sizeof(acc));
+	acc.empty = true;
+	avl_range_aggregate(root, &key_lo.avl, &key_hi.avl, metric_cmp,
+			    metric_combine, &acc);
+
+	memset(&expected, 0, sizeof(expected));
+	expected.empty = true;
+	for (i = lo; i <= hi && i < ARRAY_SIZE(metrics); i++) {
+		if (skiplist[i])
+			continue;
+
+		metric_combine(&expected, &metrics[i].avl, false);
+	}
+
+	assert(acc.empty == expected.empty);
+	assert(acc.sum == expected.sum);
+	if (!acc.empty) {
+		assert(acc.min == expected.min);
+		assert(acc.max == expected.max);
+	}
+}
+
+int main(void)
+{
+	struct avl_root root;
+	uint16_t lo, hi;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			metrics[values[j]].key = values[j];
+			metrics[values[j]].value = (int32_t)get_unsigned16() -
+						   32768;
+			metric_insert(&root, &metrics[values[j]]);
+		}
+
+		check_depth(&root);
+		check_augment(root.node);
+
+		/* remove some metrics */
+		for (j = 0; j < i % 128; j++) {
+			avl_erase_augmented(&metrics[values[j]].avl, &root,
+					    metric_augment);
+			skiplist[values[j]] = 1;
+		}
+
+		check_depth(&root);
+		check_augment(root.node);
+
+		/* change some values without modification of tree */
+		for (j = i % 128; j < ARRAY_SIZE(values); j += 7) {
+			metrics[values[j]].value = get_unsigned16() % 1024;
+			avl_augment_propagate(&metrics[values[j]].avl,
+					      metric_augment);
+		}
+
+		check_augment(root.node);
+
+		for (j = 0; j < 64; j++) {
+			lo = get_unsigned16() % 300;
+			hi = get_unsigned16() % 300;
+			if (lo > hi) {
+				lo ^= hi;
+				hi ^= lo;
+				lo ^= hi;
+			}
+
+			check_range(&root, lo, hi);
+		}
+	}
+
+	return 0;
+}
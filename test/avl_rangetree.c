@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-rangetree.h"
+#include "common-treevalidation.h"
+
+static uint8_t reported[256];
+
+static struct avl_point points[ARRAY_SIZE(reported)];
+static struct avl_node *nodes[ARRAY_SIZE(points)];
+static struct avl_point *pool[ARRAY_SIZE(points) * 16];
+
+static void report_point(struct avl_point *point, void *priv)
+{
+	size_t pos = (size_t)(point - points);
+	size_t *cnt = (size_t *)priv;
+
+	assert(!reported[pos]);
+	reported[pos] = 1;
+	(*cnt)++;
+}
+
+static void check_ys(const struct avl_node *node)
+{
+	const struct avl_point *point;
+	size_t i;
+
+	if (!node)
+		return;
+
+	check_ys(node->left);
+	check_ys(node->right);
+
+	point = avl_entry(node, const struct avl_point, avl);
+	for (i = 1; i < point->count; i++)
+		assert(point->ys[i - 1]->y <= point->ys[i]->y);
+}
+
+static void check_query(const struct avl_rangetree *tree, uint16_t x1,
+			uint16_t x2, uint16_t y1, uint16_t y2)
+{
+	size_t expected = 0;
+	size_t cnt = 0;
+	bool inside;
+	size_t i;
+
+	memset(reported, 0, sizeof(reported));
+	avl_rangetree_query(tree, x1, x2, y1, y2, report_point, &cnt);
+
+	for (i = 0; i < ARRAY_SIZE(points); i++) {
+		inside = points[i].x >= x1 && points[i].x <= x2 &&
+			 points[i].y >= y1 && points[i].y <= y2;
+
+		assert(inside == !!reported[i]);
+		if (inside)
+			expected++;
+	}
+
+	assert(cnt == expected);
+}
+
+int main(void)
+{
+	struct avl_rangetree tree;
+	uint16_t x1, x2, y1, y2;
+	uint16_t tmp;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		/* few distinct x values to get equal keys too */
+		for (j = 0; j < ARRAY_SIZE(points); j++) {
+			points[j].x = get_unsigned16() % (16 + i);
+			points[j].y = get_unsigned16() % 128;
+			nodes[j] = &points[j].avl;
+		}
+
+		assert(!avl_rangetree_build(&tree, nodes, ARRAY_SIZE(nodes),
+					    pool, ARRAY_SIZE(points)));
+
+		assert(avl_rangetree_build(&tree, nodes, ARRAY_SIZE(nodes),
+					   pool, ARRAY_SIZE(pool)));
+		check_depth(&tree.root);
+		check_ys(tree.root.node);
+
+		for (j = 0; j < 64; j++) {
+			x1 = get_unsigned16() % (20 + i);
+			x2 = get_unsigned16() % (20 + i);
+			if (x1 > x2) {
+				tmp = x1;
+				x1 = x2;
+				x2 = tmp;
+			}
+
+			y1 = get_unsigned16() % 140;
+			y2 = get_unsigned16() % 140;
+			if (y1 > y2) {
+				tmp = y1;
+				y1 = y2;
+				y2 = tmp;
+			}
+
+			check_query(&tree, x1, x2, y1, y2);
+		}
+	}
+
+	return 0;
+}
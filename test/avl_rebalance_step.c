@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+static size_t tree_height(const struct avl_node *node)
+{
+	size_t height_left;
+	size_t height_right;
+
+	if (!node)
+		return 0;
+
+	height_left = tree_height(node->left);
+	height_right = tree_height(node->right);
+
+	if (height_left > height_right)
+		return height_left + 1;
+	else
+		return height_right + 1;
+}
+
+static void check_height_slack(const struct avl_root_deferred *root, size_t n)
+{
+#ifndef AVLTREE_WAVL
+	size_t min_nodes_prev = 0;
+	size_t min_nodes = 1;
+	size_t min_nodes_next;
+	size_t height = 0;
+
+	/* largest height of an avl tree with n nodes */
+	while (min_nodes <= n) {
+		min_nodes_next = min_nodes + min_nodes_prev + 1;
+		min_nodes_prev = min_nodes;
+		min_nodes = min_nodes_next;
+		height++;
+	}
+
+	/* the pending modification can add at most one level */
+	assert(tree_height(root->root.node) <= height + 1);
+#else
+	(void)root;
+	(void)n;
+#endif
+}
+
+static void avlitem_add_deferred(struct avl_root_deferred *root,
+				 struct avlitem *new_entry, size_t budget)
+{
+	size_t height = tree_height(root->root.node);
+	size_t refused = 0;
+
+	/* every refused call continues the pending fixup on its path upwards */
+	while (!avl_add_deferred(&new_entry->avl, root, avlitem_cmp, budget)) {
+		refused++;
+		assert(refused * budget <= height);
+	}
+}
+
+static void avlitem_erase_deferred(struct avl_root_deferred *root,
+				   struct avlitem *entry, size_t budget)
+{
+	size_t height = tree_height(root->root.node);
+	size_t refused = 0;
+
+	while (!avl_erase_deferred(&entry->avl, root, budget)) {
+		refused++;
+		assert(refused * budget <= height);
+	}
+}
+
+int main(void)
+{
+	struct avl_root_deferred root;
+	struct avlitem *item;
+	size_t budget;
+	size_t count;
+	bool pending;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+		budget = 1 + i % 3;
+		count = 0;
+
+		INIT_AVL_ROOT_DEFERRED(&root);
+		assert(!avl_rebalance_step(&root, 1));
+
+		/* inserts and erases while a fixup is still pending */
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avlitem_add_deferred(&root, &items[j], budget);
+			skiplist[values[j]] = 0;
+			count++;
+
+			/* tree is always searchable */
+			check_root_order(&root.root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			assert(avlitem_find(&root.root, values[j]) == &items[j]);
+			check_height_slack(&root, count);
+
+			item = &items[get_unsigned16() % (j + 1)];
+			if (j % 3 == 2 && !skiplist[item->i]) {
+				avlitem_erase_deferred(&root, item, budget);
+				skiplist[item->i] = 1;
+				count--;
+
+				check_root_order(&root.root, skiplist,
+						 (uint16_t)ARRAY_SIZE(skiplist));
+				check_height_slack(&root, count);
+			}
+
+			if (!root.pending)
+				check_depth(&root.root);
+		}
+
+		avl_rebalance_finish(&root);
+		assert(!root.pending);
+		check_depth(&root.root);
+		check_root_order(&root.root, skiplist,
+				 (uint16_t)ARRAY_SIZE(skiplist));
+
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			item = &items[values[j]];
+			if (skiplist[item->i])
+				continue;
+
+			avlitem_erase_deferred(&root, item, budget);
+			skiplist[item->i] = 1;
+			count--;
+
+			check_root_order(&root.root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			check_height_slack(&root, count);
+
+			/* sometimes finish pending work in small steps */
+			do {
+				pending = avl_rebalance_step(&root, 1);
+			} while (j % 4 == 0 && pending);
+
+			if (!pending)
+				check_depth(&root.root);
+		}
+
+		avl_rebalance_finish(&root);
+		assert(avl_empty(&root.root));
+		assert(count == 0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem items2[ARRAY_SIZE(values)];
+static struct avlitem *mapping[ARRAY_SIZE(values)];
+
+static void item_moved(struct avl_node *old_node, struct avl_node *new_node)
+{
+	struct avlitem *old_item = avl_entry(old_node, struct avlitem, avl);
+	struct avlitem *new_item = avl_entry(new_node, struct avlitem, avl);
+
+	assert(mapping[old_item->i] == old_item);
+	assert(old_item->i == new_item->i);
+	mapping[new_item->i] = new_item;
+}
+
+static void check_relayout(struct avl_root *root, struct avlitem *dest,
+			   size_t n, enum avl_layout layout)
+{
+	struct avlitem *item;
+	size_t copied;
+	size_t j;
+
+	copied = avl_relayout(root, dest, sizeof(*dest),
+			      offsetof(struct avlitem, avl), layout,
+			      item_moved);
+	assert(copied == n);
+
+	check_root_order(root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+	check_depth(root);
+
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		if (skiplist[j])
+			continue;
+
+		item = avlitem_find(root, (uint16_t)j);
+		assert(item == mapping[j]);
+		assert(item >= dest && item < &dest[n]);
+	}
+
+	if (!n)
+		return;
+
+	switch (layout) {
+	case AVL_LAYOUT_INORDER:
+		for (j = 1; j < n; j++)
+			assert(dest[j - 1].i < dest[j].i);
+		break;
+	case AVL_LAYOUT_VEB:
+		/* root and its children are always the first entries */
+		assert(root->node == &dest[0].avl);
+		if (root->node->left && root->node->right) {
+			assert(root->node->left == &dest[1].avl);
+			assert(root->node->right >= &dest[2].avl);
+		}
+		break;
+	}
+}
+
+int main(void)
+{
+	struct avl_root root;
+	size_t i, j, n;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		n = i % ARRAY_SIZE(values);
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < n; j++) {
+			items[j].i = values[j];
+			avlitem_insert_balanced(&root, &items[j]);
+			skiplist[values[j]] = 0;
+			mapping[values[j]] = &items[j];
+		}
+
+		check_relayout(&root, items2, n,
+			       (enum avl_layout)(i % 2));
+		check_relayout(&root, items, n,
+			       (enum avl_layout)((i + 1) % 2));
+	}
+
+	return 0;
+}
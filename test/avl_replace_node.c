@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+static struct avlitem replacements[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root root;
+	struct avlitem *item;
+	size_t i, j;
+
+	memset(skiplist, 0, sizeof(skiplist));
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avlitem_insert_balanced(&root, &items[j]);
+		}
+
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			item = avlitem_find(&root, values[j]);
+			assert(item);
+
+			replacements[j].i = values[j];
+			avl_replace_node(&item->avl, &replacements[j].avl,
+					 &root);
+
+			assert(avlitem_find(&root, values[j]) == &replacements[j]);
+			if (j % 32 == 0) {
+				check_root_order(&root, skiplist,
+						 (uint16_t)ARRAY_SIZE(skiplist));
+				check_depth(&root);
+			}
+		}
+
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+	}
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+static void check_sorted(struct avl_root *root)
+{
+	struct avl_node *node;
+	struct avlitem *item;
+	uint16_t last = 0;
+	size_t cnt = 0;
+
+	for (node = avl_first(root); node; node = avl_next(node)) {
+		item = avl_entry(node, struct avlitem, avl);
+		assert(item->i >= last);
+		last = item->i;
+		cnt++;
+	}
+
+	assert(cnt == ARRAY_SIZE(values));
+	check_depth(root);
+}
+
+int main(void)
+{
+	struct avl_root root;
+	struct avlitem *prev_item;
+	struct avl_node *prev;
+	struct avl_node *next;
+	struct avlitem *item;
+	bool expect_move;
+	uint16_t old;
+	bool moved;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = (uint16_t)(values[j] * 4);
+			avl_add(&items[j].avl, &root, avlitem_cmp);
+		}
+		check_sorted(&root);
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			item = &items[get_unsigned16() % ARRAY_SIZE(items)];
+			prev = avl_prev(&item->avl);
+			next = avl_next(&item->avl);
+			old = item->i;
+
+			if (j % 2) {
+				/* small change which keeps the order */
+				if (prev) {
+					prev_item = avl_entry(prev,
+							      struct avlitem,
+							      avl);
+					item->i = (uint16_t)((prev_item->i + old) / 2);
+				}
+
+				expect_move = false;
+			} else {
+				item->i = get_unsigned16() % (4 * ARRAY_SIZE(values));
+
+				expect_move = false;
+				if (prev && avl_entry(prev, struct avlitem, avl)->i > item->i)
+					expect_move = true;
+				if (next && avl_entry(next, struct avlitem, avl)->i < item->i)
+					expect_move = true;
+			}
+
+			moved = avl_reposition(&item->avl, &root, avlitem_cmp);
+			assert(moved == expect_move);
+
+			check_sorted(&root);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treevalidation.h"
+
+struct ropeitem {
+	uint16_t i;
+	struct avl_rope_node rope;
+};
+
+static uint16_t sequence[256];
+static uint16_t rotated[ARRAY_SIZE(sequence)];
+static size_t sequence_len;
+
+static struct ropeitem items[ARRAY_SIZE(sequence)];
+static uint8_t linked[ARRAY_SIZE(sequence)];
+
+static size_t check_size(const struct avl_node *node)
+{
+	const struct avl_rope_node *rope;
+	size_t size;
+
+	if (!node)
+		return 0;
+
+	rope = avl_entry(node, const struct avl_rope_node, avl);
+	size = 1 + check_size(node->left) + check_size(node->right);
+	assert(rope->size == size);
+
+	return size;
+}
+
+static void check_sequence(const struct avl_root *root, const uint16_t *seq,
+			   size_t len)
+{
+	struct ropeitem *item;
+	struct avl_node *node;
+	size_t pos = 0;
+
+	check_depth(root);
+	assert(check_size(root->node) == len);
+	assert(avl_rope_size(root) == len);
+
+	for (node = avl_first(root); node; node = avl_next(node)) {
+		item = avl_entry(node, struct ropeitem, rope.avl);
+
+		assert(pos < len);
+		assert(item->i == seq[pos]);
+		assert(avl_rope_index(&item->rope) == pos);
+		assert(avl_rope_at(root, pos) == &item->rope);
+		pos++;
+	}
+
+	assert(pos == len);
+	assert(!avl_rope_at(root, len));
+}
+
+static void sequence_insert(struct avl_root *root, uint16_t i)
+{
+	size_t pos = get_unsigned16() % (sequence_len + 1);
+
+	items[i].i = i;
+	avl_rope_insert_at(root, &items[i].rope, pos);
+	linked[i] = 1;
+
+	memmove(&sequence[pos + 1], &sequence[pos],
+		(sequence_len - pos) * sizeof(sequence[0]));
+	sequence[pos] = i;
+	sequence_len++;
+}
+
+static void sequence_erase(struct avl_root *root)
+{
+	size_t pos = get_unsigned16() % sequence_len;
+	struct avl_rope_node *rope;
+	struct ropeitem *item;
+
+	rope = avl_rope_erase_at(root, pos);
+	assert(rope);
+
+	item = avl_entry(rope, struct ropeitem, rope);
+	assert(item->i == sequence[pos]);
+	linked[item->i] = 0;
+
+	memmove(&sequence[pos], &sequence[pos + 1],
+		(sequence_len - pos - 1) * sizeof(sequence[0]));
+	sequence_len--;
+}
+
+int main(void)
+{
+	struct avl_root root;
+	struct avl_root left;
+	struct avl_root right;
+	size_t pos;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		memset(linked, 0, sizeof(linked));
+		sequence_len = 0;
+
+		INIT_AVL_ROOT(&root);
+		assert(!avl_rope_erase_at(&root, 0));
+
+		for (j = 0; j < ARRAY_SIZE(items); j++)
+			sequence_insert(&root, (uint16_t)j);
+
+		check_sequence(&root, sequence, sequence_len);
+
+		/* erase and reinsert at random positions */
+		for (j = 0; j < ARRAY_SIZE(items); j++) {
+			if (linked[j]) {
+				sequence_erase(&root);
+				check_sequence(&root, sequence, sequence_len);
+			}
+
+			if (!linked[j]) {
+				sequence_insert(&root, (uint16_t)j);
+				check_sequence(&root, sequence, sequence_len);
+			}
+		}
+
+		/* split at random position */
+		pos = get_unsigned16() % (sequence_len + 1);
+		if (i % 2)
+			avl_rope_split_at(&root, pos, &root, &right);
+		else
+			avl_rope_split_at(&root, pos, &left, &right);
+
+		if (i % 2)
+			check_sequence(&root, sequence, pos);
+		else
+			check_sequence(&left, sequence, pos);
+		check_sequence(&right, &sequence[pos], sequence_len - pos);
+
+		/* and put both parts back together */
+		if (i % 2)
+			avl_rope_concat(&root, &root, &right);
+		else
+			avl_rope_concat(&root, &left, &right);
+
+		check_sequence(&root, sequence, sequence_len);
+		assert(avl_empty(&right));
+
+		/* concat with swapped parts */
+		pos = get_unsigned16() % (sequence_len + 1);
+		avl_rope_split_at(&root, pos, &left, &right);
+		avl_rope_concat(&root, &right, &left);
+
+		memcpy(rotated, &sequence[pos],
+		       (sequence_len - pos) * sizeof(sequence[0]));
+		memcpy(&rotated[sequence_len - pos], sequence,
+		       pos * sizeof(sequence[0]));
+		check_sequence(&root, rotated, sequence_len);
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-runqueue.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+
+static struct avl_task tasks[ARRAY_SIZE(values)];
+static struct avl_runqueue rqs[2];
+
+static void check_runqueue(const struct avl_runqueue *rq)
+{
+	const struct avl_node *node = avl_first(&rq->root);
+	const struct avl_node *next;
+	size_t cnt = 0;
+
+	check_depth(&rq->root);
+	assert(rq->leftmost == node);
+
+	for (; node; node = next) {
+		next = avl_next((struct avl_node *)node);
+		if (next)
+			assert(avl_task_vruntime(node) <=
+			       avl_task_vruntime(next));
+		cnt++;
+	}
+
+	assert(cnt == rq->nr_running);
+}
+
+int main(void)
+{
+	struct avl_task *picked;
+	struct avl_task *task;
+	uint64_t min_vruntime;
+	uint64_t vruntime;
+	uint16_t delta;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+
+		avl_runqueue_init(&rqs[0]);
+		avl_runqueue_init(&rqs[1]);
+		assert(!avl_runqueue_pick(&rqs[0]));
+		assert(!avl_runqueue_pick_requeue(&rqs[0], 1));
+
+		/* all tasks start on the first core */
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			tasks[j].vruntime = values[j] % 64;
+			avl_runqueue_enqueue(&rqs[0], &tasks[j]);
+		}
+		check_runqueue(&rqs[0]);
+
+		/* run some scheduling rounds */
+		for (j = 0; j < 512; j++) {
+			min_vruntime = rqs[0].min_vruntime;
+			task = avl_runqueue_pick(&rqs[0]);
+			vruntime = task->vruntime;
+
+			delta = get_unsigned16() % 32;
+			picked = avl_runqueue_pick_requeue(&rqs[0], delta);
+			assert(picked == task);
+			assert(task->vruntime >= vruntime);
+			assert(rqs[0].min_vruntime >= min_vruntime);
+			check_runqueue(&rqs[0]);
+		}
+
+		/* second core steals until both are balanced */
+		while (avl_runqueue_steal(&rqs[1], &rqs[0]))
+			check_runqueue(&rqs[1]);
+
+		check_runqueue(&rqs[0]);
+		check_runqueue(&rqs[1]);
+		assert(rqs[0].nr_running == ARRAY_SIZE(values) / 2);
+		assert(rqs[1].nr_running == ARRAY_SIZE(values) / 2);
+		assert(!avl_runqueue_steal(&rqs[0], &rqs[1]));
+
+		for (j = 0; j < 256; j++) {
+			delta = get_unsigned16() % 32;
+			assert(avl_runqueue_pick_requeue(&rqs[j % 2], delta));
+			check_runqueue(&rqs[j % 2]);
+		}
+
+		/* drain both queues */
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			task = avl_runqueue_pick(&rqs[j % 2]);
+			assert(task);
+			avl_runqueue_dequeue(&rqs[j % 2], task);
+			check_runqueue(&rqs[j % 2]);
+		}
+
+		assert(!avl_runqueue_pick(&rqs[0]));
+		assert(!avl_runqueue_pick(&rqs[1]));
+	}
+
+	return 0;
+}
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* pthread_join with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint16_t delete_items[ARRAY_SIZE(values)];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+static DEFINE_AVLROOT_SEQ(seqtree);
+
+static struct avlitem *avlitem_find_seq(const struct avl_root_seq *root,
+					uint16_t x)
+{
+	struct avl_node *node;
+	struct avlitem *cur_entry;
+	unsigned int seq;
+	int res;
+
+	do {
+		seq = avl_seq_read_begin(root);
+
+		node = avl_load_node(&root->root.node);
+		while (node) {
+			cur_entry = avl_entry(node, struct avlitem, avl);
+
+			res = cmpint(&x, &cur_entry->i);
+			if (res == 0)
+				break;
+
+			if (res < 0)
+				node = avl_load_node(&node->left);
+			else
+				node = avl_load_node(&node->right);
+		}
+	} while (avl_seq_read_retry(root, seq));
+
+	if (!node)
+		return NULL;
+
+	return avl_entry(node, struct avlitem, avl);
+}
+
+#ifdef AVLTREE_ATOMIC_LINKS
+static struct avlitem concurrent_items[256];
+static uint8_t concurrent_linked[ARRAY_SIZE(concurrent_items)];
+static int concurrent_stop;
+
+/* reused nodes can send a reader along stale links. The lookup is therefore
+ * bounded and must be retried when the bound was hit
+ */
+static struct avlitem *avlitem_find_seq_bounded(const struct avl_root_seq *root,
+						uint16_t x)
+{
+	struct avlitem *cur_entry;
+	struct avl_node *node;
+	unsigned int seq;
+	size_t steps;
+	int res;
+
+	do {
+		seq = avl_seq_read_begin(root);
+
+		node = avl_load_node(&root->root.node);
+		for (steps = 0; node && steps < 64; steps++) {
+			cur_entry = avl_entry(node, struct avlitem, avl);
+
+			res = cmpint(&x, &cur_entry->i);
+			if (res == 0)
+				break;
+
+			if (res < 0)
+				node = avl_load_node(&node->left);
+			else
+				node = avl_load_node(&node->right);
+		}
+	} while (avl_seq_read_retry(root, seq));
+
+	/* an AVL tree with 256 nodes is never that high */
+	assert(steps < 64);
+
+	if (!node)
+		return NULL;
+
+	return avl_entry(node, struct avlitem, avl);
+}
+
+static void *concurrent_reader(void *arg)
+{
+	const struct avl_root_seq *root = (const struct avl_root_seq *)arg;
+	uint32_t state = 1;
+	struct avlitem *item;
+	uint16_t x;
+
+	while (!__atomic_load_n(&concurrent_stop, __ATOMIC_RELAXED)) {
+		state = state * 1103515245U + 12345U;
+		x = (uint16_t)((state >> 16) % ARRAY_SIZE(concurrent_items));
+
+		item = avlitem_find_seq_bounded(root, x);
+
+		/* even keys are never erased */
+		if (x % 2 == 0)
+			assert(item == &concurrent_items[x]);
+		else
+			assert(!item || item == &concurrent_items[x]);
+	}
+
+	return NULL;
+}
+
+static void check_concurrent_readers(void)
+{
+	struct avl_root_seq root;
+	pthread_t reader;
+	uint16_t x;
+	size_t j;
+	int ret;
+
+	INIT_AVL_ROOT_SEQ(&root);
+	for (j = 0; j < ARRAY_SIZE(concurrent_items); j++) {
+		concurrent_items[j].i = (uint16_t)j;
+		avlitem_insert_balanced(&root.root, &concurrent_items[j]);
+		concurrent_linked[j] = 1;
+	}
+
+	__atomic_store_n(&concurrent_stop, 0, __ATOMIC_RELAXED);
+	ret = pthread_create(&reader, NULL, concurrent_reader, &root);
+	assert(ret == 0);
+
+	/* writer erases and reinserts odd keys while the reader searches */
+	for (j = 0; j < 200000; j++) {
+		x = (uint16_t)(get_unsigned16() % ARRAY_SIZE(concurrent_items));
+		x |= 1;
+
+		avl_seq_write_begin(&root);
+		if (concurrent_linked[x])
+			avl_erase(&concurrent_items[x].avl, &root.root);
+		else
+			avlitem_insert_balanced(&root.root,
+						&concurrent_items[x]);
+		avl_seq_write_end(&root);
+
+		concurrent_linked[x] = !concurrent_linked[x];
+	}
+
+	__atomic_store_n(&concurrent_stop, 1, __ATOMIC_RELAXED);
+	ret = pthread_join(reader, NULL);
+	assert(ret == 0);
+	(void)ret;
+
+	check_depth(&root.root);
+}
+#endif
+
+int main(void)
+{
+	struct avl_root_seq root;
+	struct avlitem *item;
+	unsigned int seq;
+	size_t i, j;
+
+	assert(avl_empty(&seqtree.root));
+	assert(!avl_seq_read_retry(&seqtree, avl_seq_read_begin(&seqtree)));
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		INIT_AVL_ROOT_SEQ(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			seq = avl_seq_read_begin(&root);
+
+			items[j].i = values[j];
+			avl_seq_write_begin(&root);
+			assert(avl_seq_read_retry(&root,
+						  avl_seq_read_begin(&root)));
+			avlitem_insert_balanced(&root.root, &items[j]);
+			avl_seq_write_end(&root);
+			skiplist[values[j]] = 0;
+
+			assert(avl_seq_read_retry(&root, seq));
+			assert(avlitem_find_seq(&root, values[j]) == &items[j]);
+		}
+
+		check_root_order(&root.root, skiplist,
+				 (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root.root);
+
+		random_shuffle_array(delete_items, (uint16_t)ARRAY_SIZE(delete_items));
+		for (j = 0; j < ARRAY_SIZE(delete_items); j++) {
+			item = avlitem_find_seq(&root, delete_items[j]);
+			assert(item);
+			assert(item->i == delete_items[j]);
+
+			seq = avl_seq_read_begin(&root);
+			assert(!avl_seq_read_retry(&root, seq));
+
+			avl_seq_write_begin(&root);
+			avl_erase(&item->avl, &root.root);
+			avl_seq_write_end(&root);
+			skiplist[item->i] = 1;
+
+			assert(avl_seq_read_retry(&root, seq));
+			assert(!avlitem_find_seq(&root, delete_items[j]));
+
+			check_root_order(&root.root, skiplist,
+					 (uint16_t)ARRAY_SIZE(skiplist));
+			check_depth(&root.root);
+		}
+		assert(avl_empty(&root.root));
+	}
+
+#ifdef AVLTREE_ATOMIC_LINKS
+	check_concurrent_readers();
+#endif
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-sharded.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint16_t delete_items[ARRAY_SIZE(values)];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+static struct avl_shard shards[4];
+static struct avl_node *cursors[ARRAY_SIZE(shards)];
+
+static void check_sharded_order(struct avl_sharded *map)
+{
+	struct avl_sharded_iter iter;
+	struct avl_node *node;
+	struct avlitem *item;
+	uint16_t pos = 0;
+	size_t i;
+
+	avl_sharded_lock_all(map);
+
+	for (node = avl_sharded_first(map, &iter, cursors);
+	     node;
+	     node = avl_sharded_next(&iter)) {
+		while (pos < ARRAY_SIZE(skiplist) && skiplist[pos])
+			pos++;
+		assert(pos < ARRAY_SIZE(skiplist));
+
+		item = avl_entry(node, struct avlitem, avl);
+		assert(item->i == pos);
+		pos++;
+	}
+
+	while (pos < ARRAY_SIZE(skiplist) && skiplist[pos])
+		pos++;
+	assert(pos == ARRAY_SIZE(skiplist));
+
+	for (i = 0; i < map->nshards; i++)
+		check_depth(&map->shards[i].root);
+
+	avl_sharded_unlock_all(map);
+}
+
+int main(void)
+{
+	struct avl_sharded map;
+	struct avlitem *item;
+	size_t i, j, k;
+
+	assert(sizeof(shards[0]) == AVL_SHARD_CACHELINE);
+	assert(((uintptr_t)&shards[1] % AVL_SHARD_CACHELINE) == 0);
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 1, sizeof(skiplist));
+
+		avl_sharded_init(&map, shards, ARRAY_SIZE(shards),
+				 ARRAY_SIZE(values), i % 2);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[j].i = values[j];
+			avl_sharded_insert(&map, &items[j]);
+			skiplist[values[j]] = 0;
+		}
+
+		for (k = 0; k < ARRAY_SIZE(shards); k++)
+			assert(!avl_empty(&shards[k].root));
+
+		check_sharded_order(&map);
+
+		random_shuffle_array(delete_items, (uint16_t)ARRAY_SIZE(delete_items));
+		for (j = 0; j < ARRAY_SIZE(delete_items); j++) {
+			item = avl_sharded_find(&map, delete_items[j]);
+			assert(item);
+			assert(item->i == delete_items[j]);
+
+			avl_sharded_erase(&map, item);
+			skiplist[item->i] = 1;
+			assert(!avl_sharded_find(&map, delete_items[j]));
+
+			if (j % 16 == 0)
+				check_sharded_order(&map);
+		}
+
+		for (k = 0; k < ARRAY_SIZE(shards); k++)
+			assert(avl_empty(&shards[k].root));
+	}
+
+	return 0;
+}
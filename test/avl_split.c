@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t skiplist[ARRAY_SIZE(values)];
+
+static struct avlitem items[ARRAY_SIZE(values)];
+
+int main(void)
+{
+	struct avl_root left;
+	struct avl_root right;
+	struct avl_root root;
+	struct avl_node *found;
+	struct avlitem key;
+	bool with_key;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(skiplist, 0, sizeof(skiplist));
+
+		key.i = get_unsigned16() % ARRAY_SIZE(values);
+		with_key = i % 2;
+
+		INIT_AVL_ROOT(&root);
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			items[values[j]].i = values[j];
+
+			if (!with_key && values[j] == key.i) {
+				skiplist[values[j]] = 1;
+				continue;
+			}
+
+			avlitem_insert_balanced(&root, &items[values[j]]);
+		}
+
+		found = avl_split(&root, &key.avl, avlitem_cmp, &left, &right);
+		assert(avl_empty(&root));
+		if (with_key)
+			assert(found == &items[key.i].avl);
+		else
+			assert(!found);
+
+		skiplist[key.i] = 1;
+		for (j = key.i; j < ARRAY_SIZE(values); j++)
+			skiplist[j] = 1;
+		check_root_order(&left, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&left);
+
+		for (j = 0; j < ARRAY_SIZE(values); j++)
+			skiplist[j] = j <= key.i;
+		check_root_order(&right, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&right);
+
+		/* join both halves again with the removed node */
+		avl_join(&root, &left, &items[key.i].avl, &right);
+		memset(skiplist, 0, sizeof(skiplist));
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+
+		/* split of tree in itself */
+		found = avl_split(&root, &key.avl, avlitem_cmp, &root, &right);
+		assert(found == &items[key.i].avl);
+		for (j = 0; j < ARRAY_SIZE(values); j++)
+			skiplist[j] = j >= key.i;
+		check_root_order(&root, skiplist, (uint16_t)ARRAY_SIZE(skiplist));
+		check_depth(&root);
+	}
+
+	return 0;
+}
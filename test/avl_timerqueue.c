@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-timerqueue.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t fired[ARRAY_SIZE(values)];
+static uint8_t expected[ARRAY_SIZE(values)];
+
+static struct avl_timer timers[ARRAY_SIZE(values)];
+static struct avl_timerqueue queue;
+static uint64_t last_fired;
+static uint64_t now;
+
+static void timer_fired(struct avl_timer *timer)
+{
+	size_t pos = (size_t)(timer - timers);
+
+	assert(!timer->pending);
+	assert(timer->expires <= now);
+	assert(timer->expires >= last_fired);
+	assert(fired[pos] < expected[pos]);
+
+	fired[pos]++;
+	last_fired = timer->expires;
+
+	/* periodic timers are rearmed once from their expiry function */
+	if (fired[pos] < expected[pos]) {
+		avl_timerqueue_rearm(&queue, timer, now + 1 + pos % 32);
+		assert(timer->pending);
+	}
+}
+
+static void check_queue(const struct avl_timerqueue *queue)
+{
+	struct avl_timer *first = avl_timerqueue_peek(queue);
+	struct avl_node *node = avl_first(&queue->root);
+
+	check_depth(&queue->root);
+
+	if (!node) {
+		assert(!first);
+		return;
+	}
+
+	assert(first && &first->avl == node);
+	assert(first->expires > now);
+}
+
+int main(void)
+{
+	size_t i, j, cnt;
+
+	for (i = 0; i < 256; i++) {
+		random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+		memset(fired, 0, sizeof(fired));
+		memset(expected, 1, sizeof(expected));
+		last_fired = 0;
+		now = 0;
+
+		avl_timerqueue_init(&queue);
+		assert(!avl_timerqueue_peek(&queue));
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			avl_timer_init(&timers[j]);
+			timers[j].expires = 1 + values[j] % 128;
+			avl_timerqueue_add(&queue, &timers[j]);
+
+			if (j % 5 == 0)
+				expected[j] = 2;
+		}
+		check_queue(&queue);
+
+		/* rearm some timers to new random times */
+		for (j = 0; j < ARRAY_SIZE(values); j += 1 + i % 4) {
+			avl_timerqueue_rearm(&queue, &timers[j],
+					     1 + get_unsigned16() % 128);
+			check_queue(&queue);
+		}
+
+		/* cancel a few timers */
+		for (j = 0; j < ARRAY_SIZE(values); j += 17) {
+			avl_timerqueue_del(&queue, &timers[j]);
+			assert(!timers[j].pending);
+			expected[j] = 0;
+
+			/* deleting a timer twice is ignored */
+			avl_timerqueue_del(&queue, &timers[j]);
+		}
+		check_queue(&queue);
+
+		cnt = 0;
+		for (j = 0; j < ARRAY_SIZE(values); j++)
+			cnt += expected[j];
+
+		while (avl_timerqueue_peek(&queue)) {
+			now += 1 + get_unsigned16() % 16;
+			cnt -= avl_timerqueue_expire(&queue, now, timer_fired);
+			check_queue(&queue);
+		}
+		assert(cnt == 0);
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			assert(fired[j] == expected[j]);
+			assert(!timers[j].pending);
+		}
+	}
+
+	return 0;
+}
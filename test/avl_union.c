@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-setops.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+int main(void)
+{
+	struct avl_root a;
+	struct avl_root b;
+	struct avlitem *item;
+	size_t i, j;
+
+	for (i = 0; i < 256; i++) {
+		setops_prepare(&a, &b, (unsigned int)i);
+
+		avl_union(&a, &b, avlitem_cmp, setops_drop);
+		assert(avl_empty(&b));
+
+		for (j = 0; j < ARRAY_SIZE(values); j++) {
+			setops_skiplist[j] = !in_a[j] && !in_b[j];
+			assert(!dropped[0][j]);
+			assert(dropped[1][j] == (in_a[j] && in_b[j]));
+
+			item = avlitem_find(&a, (uint16_t)j);
+			if (in_a[j])
+				assert(item == &items_a[j]);
+			else if (in_b[j])
+				assert(item == &items_b[j]);
+		}
+
+		check_root_order(&a, setops_skiplist,
+				 (uint16_t)ARRAY_SIZE(setops_skiplist));
+		check_depth(&a);
+	}
+
+	return 0;
+}
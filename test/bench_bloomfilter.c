@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+#include "common-bloomfilter.h"
+#include "common-treeops.h"
+
+/* even keys are in the tree, odd keys are misses */
+#define BENCH_ITEMS 16384
+#define BENCH_LOOKUPS 65536
+
+static struct avlitem items[BENCH_ITEMS];
+static uint8_t counters[BENCH_ITEMS * 16];
+static uint16_t keys[BENCH_LOOKUPS];
+
+static void bench_run(struct avl_bloomtree *tree, unsigned int miss_percent,
+		      size_t reps, uint32_t *seed)
+{
+	uint64_t ns_bloom = 0;
+	uint64_t ns_plain = 0;
+	size_t found = 0;
+	struct avlitem *item;
+	char label[64];
+	uint64_t start;
+	uint16_t key;
+	size_t i, j;
+
+	for (j = 0; j < ARRAY_SIZE(keys); j++) {
+		key = (uint16_t)(2 * (bench_random(seed) % BENCH_ITEMS));
+		if (bench_random(seed) % 100 < miss_percent)
+			key++;
+
+		keys[j] = key;
+	}
+
+	for (i = 0; i < reps; i++) {
+		start = bench_now();
+		for (j = 0; j < ARRAY_SIZE(keys); j++) {
+			item = avl_bloomtree_find(tree, keys[j]);
+			if (item)
+				found++;
+		}
+		ns_bloom += bench_now() - start;
+
+		start = bench_now();
+		for (j = 0; j < ARRAY_SIZE(keys); j++) {
+			item = avlitem_find(&tree->root, keys[j]);
+			if (item)
+				found++;
+		}
+		ns_plain += bench_now() - start;
+	}
+	bench_consume(found);
+
+	snprintf(label, sizeof(label), "%2u%% misses: avl_bloomtree_find",
+		 miss_percent);
+	bench_report(label, reps * ARRAY_SIZE(keys), ns_bloom);
+
+	snprintf(label, sizeof(label), "%2u%% misses: avlitem_find",
+		 miss_percent);
+	bench_report(label, reps * ARRAY_SIZE(keys), ns_plain);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t reps = 16 * bench_scale(argc, argv);
+	struct avl_bloomtree tree;
+	size_t false_positives = 0;
+	unsigned int miss_percent;
+	uint32_t seed = 1;
+	size_t i;
+
+	avl_bloomtree_init(&tree, counters, ARRAY_SIZE(counters));
+	for (i = 0; i < ARRAY_SIZE(items); i++) {
+		items[i].i = (uint16_t)(2 * i);
+		avl_bloomtree_insert(&tree, &items[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(items); i++) {
+		if (avl_bloomtree_maybe(&tree, (uint16_t)(2 * i + 1)))
+			false_positives++;
+	}
+	printf("false positives: %lu of %lu misses\n",
+	       (unsigned long)false_positives,
+	       (unsigned long)ARRAY_SIZE(items));
+
+	for (miss_percent = 10; miss_percent <= 90; miss_percent += 20)
+		bench_run(&tree, miss_percent, reps, &seed);
+
+	return 0;
+}
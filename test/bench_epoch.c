@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime and pthread_join with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+
+#ifdef AVLTREE_ATOMIC_LINKS
+enum bench_mode {
+	BENCH_EPOCH,
+	BENCH_MUTEX
+};
+
+struct epochitem {
+	struct benchitem item;
+	struct avl_epoch_entry epoch;
+};
+
+struct bench_reader {
+	pthread_t thread;
+	struct avl_epoch_reader epoch;
+	enum bench_mode mode;
+	uint32_t seed;
+	size_t lookups;
+	uint64_t ns;
+};
+
+static struct avl_root bench_root;
+static struct avl_epoch bench_epoch;
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct epochitem **bench_live;
+static size_t bench_readers;
+static size_t bench_keys;
+static int bench_stop;
+
+static void epochitem_free(struct avl_epoch_entry *entry)
+{
+	free(container_of(entry, struct epochitem, epoch));
+}
+
+static struct epochitem *epochitem_alloc(uint32_t key)
+{
+	struct epochitem *eitem;
+
+	eitem = (struct epochitem *)malloc(sizeof(*eitem));
+	assert(eitem);
+	eitem->item.key = key;
+
+	return eitem;
+}
+
+/* stale links can send a lockless reader in circles while rotating */
+static struct benchitem *benchitem_find_bounded(const struct avl_root *root,
+						uint32_t key)
+{
+	struct benchitem *cur_entry;
+	struct avl_node *node;
+	size_t steps;
+
+	node = avl_load_node(&root->node);
+	for (steps = 0; node && steps < 64; steps++) {
+		cur_entry = avl_entry(node, struct benchitem, avl);
+
+		if (key == cur_entry->key)
+			return cur_entry;
+
+		if (key < cur_entry->key)
+			node = avl_load_node(&node->left);
+		else
+			node = avl_load_node(&node->right);
+	}
+
+	return NULL;
+}
+
+static void *bench_reader_run(void *arg)
+{
+	struct bench_reader *reader = (struct bench_reader *)arg;
+	uint64_t start = bench_cpu_now();
+	struct benchitem *item;
+	uint32_t key;
+
+	while (!__atomic_load_n(&bench_stop, __ATOMIC_RELAXED)) {
+		key = (uint32_t)(bench_random(&reader->seed) % bench_keys);
+
+		switch (reader->mode) {
+		case BENCH_EPOCH:
+			avl_epoch_enter(&bench_epoch, &reader->epoch);
+			item = benchitem_find_bounded(&bench_root, key);
+			if (item)
+				bench_consume(item->key);
+			avl_epoch_exit(&reader->epoch);
+			break;
+		case BENCH_MUTEX:
+			pthread_mutex_lock(&bench_mutex);
+			item = benchitem_find_bounded(&bench_root, key);
+			if (item)
+				bench_consume(item->key);
+			pthread_mutex_unlock(&bench_mutex);
+			break;
+		}
+
+		reader->lookups++;
+	}
+
+	reader->ns = bench_cpu_now() - start;
+
+	return NULL;
+}
+
+/* replace entry with a new allocation so the old one has to be retired */
+static void bench_replace(enum bench_mode mode, size_t pos)
+{
+	struct epochitem *old_item = bench_live[pos];
+	struct epochitem *new_item;
+
+	new_item = epochitem_alloc(old_item->item.key);
+
+	switch (mode) {
+	case BENCH_EPOCH:
+		avl_erase(&old_item->item.avl, &bench_root);
+		avl_add(&new_item->item.avl, &bench_root, benchitem_cmp);
+		avl_epoch_retire(&bench_epoch, &old_item->epoch,
+				 epochitem_free);
+		if (pos % 16 == 0)
+			avl_epoch_reclaim(&bench_epoch);
+		break;
+	case BENCH_MUTEX:
+		pthread_mutex_lock(&bench_mutex);
+		avl_erase(&old_item->item.avl, &bench_root);
+		avl_add(&new_item->item.avl, &bench_root, benchitem_cmp);
+		pthread_mutex_unlock(&bench_mutex);
+		free(old_item);
+		break;
+	}
+
+	bench_live[pos] = new_item;
+}
+
+static void bench_run(enum bench_mode mode, const char *name, size_t writes)
+{
+	struct bench_reader *readers;
+	char label[64];
+	uint32_t seed = 1;
+	uint64_t lookups_ns = 0;
+	size_t lookups = 0;
+	uint64_t start;
+	uint64_t ns;
+	size_t i;
+	int ret;
+
+	INIT_AVL_ROOT(&bench_root);
+	INIT_AVL_EPOCH(&bench_epoch);
+	for (i = 0; i < bench_keys; i++) {
+		bench_live[i] = epochitem_alloc((uint32_t)i);
+		avl_add(&bench_live[i]->item.avl, &bench_root, benchitem_cmp);
+	}
+
+	readers = (struct bench_reader *)malloc(bench_readers *
+						sizeof(*readers));
+	assert(readers);
+
+	__atomic_store_n(&bench_stop, 0, __ATOMIC_RELAXED);
+	for (i = 0; i < bench_readers; i++) {
+		readers[i].mode = mode;
+		readers[i].seed = (uint32_t)(i + 2);
+		readers[i].lookups = 0;
+		avl_epoch_register(&bench_epoch, &readers[i].epoch);
+	}
+
+	for (i = 0; i < bench_readers; i++) {
+		ret = pthread_create(&readers[i].thread, NULL,
+				     bench_reader_run, &readers[i]);
+		assert(ret == 0);
+	}
+
+	/* cpu times are still meaningful when readers and writer share cpus */
+	start = bench_cpu_now();
+	for (i = 0; i < writes; i++)
+		bench_replace(mode, bench_random(&seed) % bench_keys);
+	ns = bench_cpu_now() - start;
+
+	__atomic_store_n(&bench_stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < bench_readers; i++) {
+		ret = pthread_join(readers[i].thread, NULL);
+		assert(ret == 0);
+		lookups += readers[i].lookups;
+		lookups_ns += readers[i].ns;
+	}
+	(void)ret;
+
+	snprintf(label, sizeof(label), "%s: lookup (%lu readers)", name,
+		 (unsigned long)bench_readers);
+	bench_report(label, lookups, lookups_ns);
+
+	snprintf(label, sizeof(label), "%s: replace", name);
+	bench_report(label, writes, ns);
+
+	for (i = 0; i < bench_readers; i++)
+		avl_epoch_unregister(&bench_epoch, &readers[i].epoch);
+	free(readers);
+
+	avl_epoch_reclaim(&bench_epoch);
+	avl_epoch_reclaim(&bench_epoch);
+
+	for (i = 0; i < bench_keys; i++) {
+		avl_erase(&bench_live[i]->item.avl, &bench_root);
+		free(bench_live[i]);
+	}
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef AVLTREE_ATOMIC_LINKS
+	size_t scale = bench_scale(argc, argv);
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	/* one reader per remaining cpu next to the writer */
+	bench_readers = 1;
+	if (cpus > 2)
+		bench_readers = (size_t)cpus - 1;
+
+	bench_keys = 16384 * scale;
+	bench_live = (struct epochitem **)malloc(bench_keys *
+						 sizeof(*bench_live));
+	assert(bench_live);
+
+	bench_run(BENCH_EPOCH, "epoch", 200000 * scale);
+	bench_run(BENCH_MUTEX, "mutex", 200000 * scale);
+
+	free(bench_live);
+#else
+	(void)argc;
+	(void)argv;
+
+	printf("epoch benchmark requires AVLTREE_ATOMIC_LINKS\n");
+#endif
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+
+static int benchitem_sort_cmp(const void *a, const void *b)
+{
+	const struct avl_node * const *node_a;
+	const struct avl_node * const *node_b;
+
+	node_a = (const struct avl_node * const *)a;
+	node_b = (const struct avl_node * const *)b;
+
+	return benchitem_cmp(*node_a, *node_b);
+}
+
+static void bench_run(struct avl_root *root, size_t batch, uint32_t *seed)
+{
+	struct benchitem *items;
+	struct avl_node **nodes;
+	uint64_t ns_batch = 0;
+	uint64_t ns_loop = 0;
+	char label[64];
+	uint64_t start;
+	size_t reps;
+	size_t i, j;
+
+	items = (struct benchitem *)malloc(batch * sizeof(*items));
+	nodes = (struct avl_node **)malloc(batch * sizeof(*nodes));
+	assert(items);
+	assert(nodes);
+
+	for (j = 0; j < batch; j++) {
+		items[j].key = bench_random(seed);
+		nodes[j] = &items[j].avl;
+	}
+	qsort(nodes, batch, sizeof(*nodes), benchitem_sort_cmp);
+
+	/* roughly the same number of inserted nodes for each batch size */
+	reps = 1000000 / batch;
+	if (!reps)
+		reps = 1;
+
+	for (i = 0; i < reps; i++) {
+		start = bench_now();
+		avl_insert_batch(root, nodes, batch, benchitem_cmp);
+		ns_batch += bench_now() - start;
+
+		for (j = 0; j < batch; j++)
+			avl_erase(nodes[j], root);
+
+		start = bench_now();
+		for (j = 0; j < batch; j++)
+			avl_add(nodes[j], root, benchitem_cmp);
+		ns_loop += bench_now() - start;
+
+		for (j = 0; j < batch; j++)
+			avl_erase(nodes[j], root);
+	}
+
+	snprintf(label, sizeof(label), "batch %7lu: avl_insert_batch",
+		 (unsigned long)batch);
+	bench_report(label, reps * batch, ns_batch);
+
+	snprintf(label, sizeof(label), "batch %7lu: avl_add loop",
+		 (unsigned long)batch);
+	bench_report(label, reps * batch, ns_loop);
+
+	free(nodes);
+	free(items);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = 100000 * bench_scale(argc, argv);
+	struct benchitem *items;
+	struct avl_root root;
+	uint32_t seed = 1;
+	size_t batch;
+	size_t i;
+
+	items = (struct benchitem *)malloc(count * sizeof(*items));
+	assert(items);
+
+	/* batches are inserted into a tree which already has nodes */
+	INIT_AVL_ROOT(&root);
+	for (i = 0; i < count; i++) {
+		items[i].key = bench_random(&seed);
+		avl_add(&items[i].avl, &root, benchitem_cmp);
+	}
+
+	for (batch = 10; batch <= 1000000; batch *= 10)
+		bench_run(&root, batch, &seed);
+
+	free(items);
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+#include "common-rangetree.h"
+
+#define BENCH_POINTS 65536
+#define BENCH_QUERIES 256
+
+/* x and y are spread over the full uint16_t range */
+static struct avl_point points[BENCH_POINTS];
+static struct avl_node *nodes[ARRAY_SIZE(points)];
+static struct avl_point *pool[ARRAY_SIZE(points) * 20];
+
+struct bench_query {
+	uint16_t x1;
+	uint16_t x2;
+	uint16_t y1;
+	uint16_t y2;
+};
+
+static struct bench_query queries[BENCH_QUERIES];
+
+static void bench_count(struct avl_point *point, void *priv)
+{
+	size_t *cnt = (size_t *)priv;
+
+	(void)point;
+	(*cnt)++;
+}
+
+/* x range lookup in the primary tree and filter by y */
+static void bench_scan(const struct avl_rangetree *tree, uint16_t x1,
+		       uint16_t x2, uint16_t y1, uint16_t y2,
+		       avl_point_report_t report, void *priv)
+{
+	struct avl_node *node = tree->root.node;
+	struct avl_node *first = NULL;
+	struct avl_point *point;
+
+	while (node) {
+		point = avl_entry(node, struct avl_point, avl);
+
+		if (point->x < x1) {
+			node = node->right;
+		} else {
+			first = node;
+			node = node->left;
+		}
+	}
+
+	for (node = first; node; node = avl_next(node)) {
+		point = avl_entry(node, struct avl_point, avl);
+		if (point->x > x2)
+			break;
+
+		avl_point_report(point, y1, y2, report, priv);
+	}
+}
+
+static void bench_queries_init(uint32_t xwidth, uint32_t ywidth,
+			       uint32_t *seed)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(queries); i++) {
+		queries[i].x1 = (uint16_t)(bench_random(seed) %
+					   (65536 - xwidth + 1));
+		queries[i].x2 = (uint16_t)(queries[i].x1 + xwidth - 1);
+		queries[i].y1 = (uint16_t)(bench_random(seed) %
+					   (65536 - ywidth + 1));
+		queries[i].y2 = (uint16_t)(queries[i].y1 + ywidth - 1);
+	}
+}
+
+static void bench_run(const struct avl_rangetree *tree, uint32_t xwidth,
+		      uint32_t ywidth, size_t reps, uint32_t *seed)
+{
+	uint64_t ns_range = 0;
+	uint64_t ns_scan = 0;
+	size_t cnt_range = 0;
+	size_t cnt_scan = 0;
+	char label[64];
+	uint64_t start;
+	size_t i, j;
+
+	bench_queries_init(xwidth, ywidth, seed);
+
+	for (i = 0; i < reps; i++) {
+		start = bench_now();
+		for (j = 0; j < ARRAY_SIZE(queries); j++)
+			avl_rangetree_query(tree, queries[j].x1, queries[j].x2,
+					    queries[j].y1, queries[j].y2,
+					    bench_count, &cnt_range);
+		ns_range += bench_now() - start;
+
+		start = bench_now();
+		for (j = 0; j < ARRAY_SIZE(queries); j++)
+			bench_scan(tree, queries[j].x1, queries[j].x2,
+				   queries[j].y1, queries[j].y2, bench_count,
+				   &cnt_scan);
+		ns_scan += bench_now() - start;
+	}
+
+	/* both have to find the same points */
+	assert(cnt_range == cnt_scan);
+
+	snprintf(label, sizeof(label), "x %5lu y %5lu (%5.0f pts): rangetree",
+		 (unsigned long)xwidth, (unsigned long)ywidth,
+		 (double)cnt_range / (double)(reps * ARRAY_SIZE(queries)));
+	bench_report(label, reps * ARRAY_SIZE(queries), ns_range);
+
+	snprintf(label, sizeof(label), "x %5lu y %5lu (%5.0f pts): 1-D scan",
+		 (unsigned long)xwidth, (unsigned long)ywidth,
+		 (double)cnt_scan / (double)(reps * ARRAY_SIZE(queries)));
+	bench_report(label, reps * ARRAY_SIZE(queries), ns_scan);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t reps = bench_scale(argc, argv);
+	struct avl_rangetree tree;
+	uint32_t seed = 1;
+	uint64_t start;
+	bool built;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(points); i++) {
+		points[i].x = (uint16_t)bench_random(&seed);
+		points[i].y = (uint16_t)bench_random(&seed);
+		nodes[i] = &points[i].avl;
+	}
+
+	start = bench_now();
+	built = avl_rangetree_build(&tree, nodes, ARRAY_SIZE(nodes), pool,
+				    ARRAY_SIZE(pool));
+	bench_report("avl_rangetree_build", ARRAY_SIZE(points),
+		     bench_now() - start);
+	assert(built);
+	(void)built;
+
+	/* narrow y ranges make the 1-D scan throw away most points */
+	bench_run(&tree, 256, 256, reps, &seed);
+	bench_run(&tree, 256, 65536, reps, &seed);
+	bench_run(&tree, 4096, 256, reps, &seed);
+	bench_run(&tree, 4096, 4096, reps, &seed);
+	bench_run(&tree, 65536, 256, reps, &seed);
+	bench_run(&tree, 65536, 4096, reps, &seed);
+
+	return 0;
+}
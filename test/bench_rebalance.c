@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+
+#ifdef AVLTREE_WAVL
+#define BENCH_MODE "wavl"
+#else
+#define BENCH_MODE "avl"
+#endif
+
+struct bench_snapshot {
+	struct avl_node *parent;
+	struct avl_node *left;
+	struct avl_node *right;
+	enum avl_node_balance balance;
+};
+
+struct bench_counts {
+	size_t ops;
+	size_t links;
+	size_t balances;
+};
+
+struct bench_churn {
+	struct avl_root root;
+	struct benchitem *items;
+	bool *present;
+	size_t count;
+	size_t size;
+	uint32_t seed;
+};
+
+static void bench_churn_init(struct bench_churn *churn, size_t size)
+{
+	size_t i;
+
+	churn->items = (struct benchitem *)malloc(size *
+						  sizeof(*churn->items));
+	churn->present = (bool *)malloc(size * sizeof(*churn->present));
+	assert(churn->items);
+	assert(churn->present);
+
+	INIT_AVL_ROOT(&churn->root);
+	churn->count = 0;
+	churn->size = size;
+	churn->seed = 1;
+
+	for (i = 0; i < size; i++) {
+		churn->items[i].key = (uint32_t)i;
+		churn->present[i] = false;
+	}
+}
+
+static void bench_churn_free(struct bench_churn *churn)
+{
+	free(churn->present);
+	free(churn->items);
+}
+
+/* random item which is (not) in the tree */
+static size_t bench_churn_pick(struct bench_churn *churn, bool present)
+{
+	size_t pos;
+
+	do {
+		pos = bench_random(&churn->seed) % churn->size;
+	} while (churn->present[pos] != present);
+
+	return pos;
+}
+
+/* fill tree completely and then erase two nodes for each insert until only
+ * a quarter is left
+ */
+static bool bench_churn_step(struct bench_churn *churn, bool *erase,
+			     size_t *pos)
+{
+	if (churn->count < churn->size / 4)
+		return false;
+
+	*erase = churn->count == churn->size ||
+		 bench_random(&churn->seed) % 3 != 0;
+	*pos = bench_churn_pick(churn, *erase);
+
+	return true;
+}
+
+static void bench_churn_apply(struct bench_churn *churn, bool erase,
+			      size_t pos)
+{
+	if (erase) {
+		avl_erase(&churn->items[pos].avl, &churn->root);
+		churn->present[pos] = false;
+		churn->count--;
+	} else {
+		avl_add(&churn->items[pos].avl, &churn->root, benchitem_cmp);
+		churn->present[pos] = true;
+		churn->count++;
+	}
+}
+
+static void bench_churn_fill(struct bench_churn *churn)
+{
+	size_t pos;
+
+	while (churn->count < churn->size) {
+		pos = bench_churn_pick(churn, false);
+		bench_churn_apply(churn, false, pos);
+	}
+}
+
+static void bench_snapshot_take(struct bench_churn *churn,
+				struct bench_snapshot *snapshot)
+{
+	struct avl_node *node;
+	size_t i;
+
+	for (i = 0; i < churn->size; i++) {
+		node = &churn->items[i].avl;
+
+		snapshot[i].parent = avl_parent(node);
+		snapshot[i].left = node->left;
+		snapshot[i].right = node->right;
+		snapshot[i].balance = avl_balance(node);
+	}
+}
+
+/* count the nodes (without the inserted/erased one) which were written */
+static void bench_snapshot_count(struct bench_churn *churn,
+				 const struct bench_snapshot *snapshot,
+				 size_t skip, struct bench_counts *counts)
+{
+	struct avl_node *node;
+	size_t i;
+
+	counts->ops++;
+
+	for (i = 0; i < churn->size; i++) {
+		if (i == skip || !churn->present[i])
+			continue;
+
+		node = &churn->items[i].avl;
+
+		if (snapshot[i].parent != avl_parent(node) ||
+		    snapshot[i].left != node->left ||
+		    snapshot[i].right != node->right)
+			counts->links++;
+
+		if (snapshot[i].balance != avl_balance(node))
+			counts->balances++;
+	}
+}
+
+static void bench_report_counts(const char *name,
+				const struct bench_counts *counts)
+{
+	double links = 0.0;
+	double balances = 0.0;
+
+	if (counts->ops) {
+		links = (double)counts->links / (double)counts->ops;
+		balances = (double)counts->balances / (double)counts->ops;
+	}
+
+	printf("%-48s %10lu ops %6.2f link %6.2f balance writes/op\n", name,
+	       (unsigned long)counts->ops, links, balances);
+}
+
+static void bench_count_writes(size_t size)
+{
+	struct bench_counts counts_insert = { 0, 0, 0 };
+	struct bench_counts counts_erase = { 0, 0, 0 };
+	struct bench_snapshot *snapshot;
+	struct bench_churn churn;
+	bool erase;
+	size_t pos;
+
+	bench_churn_init(&churn, size);
+	bench_churn_fill(&churn);
+
+	snapshot = (struct bench_snapshot *)malloc(size * sizeof(*snapshot));
+	assert(snapshot);
+
+	while (bench_churn_step(&churn, &erase, &pos)) {
+		bench_snapshot_take(&churn, snapshot);
+		bench_churn_apply(&churn, erase, pos);
+
+		if (erase)
+			bench_snapshot_count(&churn, snapshot, pos,
+					     &counts_erase);
+		else
+			bench_snapshot_count(&churn, snapshot, pos,
+					     &counts_insert);
+	}
+
+	bench_report_counts(BENCH_MODE ": churn erase", &counts_erase);
+	bench_report_counts(BENCH_MODE ": churn insert", &counts_insert);
+
+	free(snapshot);
+	bench_churn_free(&churn);
+}
+
+static void bench_time(size_t size)
+{
+	struct bench_churn churn;
+	size_t ops = 0;
+	uint64_t start;
+	uint64_t ns;
+	bool erase;
+	size_t pos;
+
+	bench_churn_init(&churn, size);
+	bench_churn_fill(&churn);
+
+	/* the picks are part of the measurement for both modes */
+	start = bench_now();
+	while (bench_churn_step(&churn, &erase, &pos)) {
+		bench_churn_apply(&churn, erase, pos);
+		ops++;
+	}
+	ns = bench_now() - start;
+
+	bench_report(BENCH_MODE ": churn erase/insert", ops, ns);
+
+	bench_churn_free(&churn);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t scale = bench_scale(argc, argv);
+
+	/* the write counts compare all nodes after each operation */
+	bench_count_writes(4096 * scale);
+	bench_time(262144 * scale);
+
+	return 0;
+}
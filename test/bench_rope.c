@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+
+/* the array based sequences move O(n) elements per random insert. They get
+ * fewer inserts so each run moves roughly the same amount of memory
+ */
+#define BENCH_ROPE_INSERTS 100000
+#define BENCH_ARRAY_MOVES 1000000000
+
+struct ropeitem {
+	uint32_t value;
+	struct avl_rope_node rope;
+};
+
+/* elements in [0, start) and [end, capacity) with the gap between them */
+struct gapbuffer {
+	uint32_t *data;
+	size_t start;
+	size_t end;
+};
+
+struct bench_pos {
+	uint32_t seed;
+	size_t cursor;
+	bool local;
+};
+
+/* random position or edit cursor which moves only a few elements */
+static size_t bench_pos_next(struct bench_pos *pos, size_t len)
+{
+	size_t step;
+
+	if (!pos->local)
+		return bench_random(&pos->seed) % (len + 1);
+
+	step = bench_random(&pos->seed) % 32;
+	if (step < 16 && pos->cursor >= step)
+		pos->cursor -= step;
+	else if (step >= 16 && pos->cursor + step - 16 <= len)
+		pos->cursor += step - 16;
+
+	return pos->cursor;
+}
+
+static void bench_pos_init(struct bench_pos *pos, size_t len, bool local)
+{
+	pos->seed = 1;
+	pos->cursor = len / 2;
+	pos->local = local;
+}
+
+static void bench_rope(size_t len, size_t inserts, bool local)
+{
+	struct ropeitem *items;
+	struct bench_pos pos;
+	struct avl_root root;
+	char label[64];
+	uint64_t start;
+	size_t i;
+
+	items = (struct ropeitem *)malloc((len + inserts) * sizeof(*items));
+	assert(items);
+
+	INIT_AVL_ROOT(&root);
+	for (i = 0; i < len; i++) {
+		items[i].value = (uint32_t)i;
+		avl_rope_insert_at(&root, &items[i].rope, i);
+	}
+
+	bench_pos_init(&pos, len, local);
+	start = bench_now();
+	for (i = len; i < len + inserts; i++) {
+		items[i].value = (uint32_t)i;
+		avl_rope_insert_at(&root, &items[i].rope,
+				   bench_pos_next(&pos, i));
+	}
+
+	snprintf(label, sizeof(label), "%8lu %s: avl_rope_insert_at",
+		 (unsigned long)len, local ? "local " : "random");
+	bench_report(label, inserts, bench_now() - start);
+
+	free(items);
+}
+
+static void bench_vector(size_t len, size_t inserts, bool local)
+{
+	struct bench_pos pos;
+	char label[64];
+	uint64_t start;
+	uint32_t *data;
+	size_t at;
+	size_t i;
+
+	data = (uint32_t *)malloc((len + inserts) * sizeof(*data));
+	assert(data);
+
+	for (i = 0; i < len; i++)
+		data[i] = (uint32_t)i;
+
+	bench_pos_init(&pos, len, local);
+	start = bench_now();
+	for (i = len; i < len + inserts; i++) {
+		at = bench_pos_next(&pos, i);
+		memmove(&data[at + 1], &data[at], (i - at) * sizeof(*data));
+		data[at] = (uint32_t)i;
+	}
+
+	snprintf(label, sizeof(label), "%8lu %s: vector",
+		 (unsigned long)len, local ? "local " : "random");
+	bench_report(label, inserts, bench_now() - start);
+	bench_consume(data[len / 2]);
+
+	free(data);
+}
+
+static void gapbuffer_insert(struct gapbuffer *buf, size_t at, uint32_t value)
+{
+	size_t cnt;
+
+	if (at < buf->start) {
+		cnt = buf->start - at;
+		memmove(&buf->data[buf->end - cnt], &buf->data[at],
+			cnt * sizeof(*buf->data));
+		buf->start -= cnt;
+		buf->end -= cnt;
+	} else if (at > buf->start) {
+		cnt = at - buf->start;
+		memmove(&buf->data[buf->start], &buf->data[buf->end],
+			cnt * sizeof(*buf->data));
+		buf->start += cnt;
+		buf->end += cnt;
+	}
+
+	buf->data[buf->start++] = value;
+}
+
+static void bench_gapbuffer(size_t len, size_t inserts, bool local)
+{
+	struct gapbuffer buf;
+	struct bench_pos pos;
+	char label[64];
+	uint64_t start;
+	size_t i;
+
+	/* the gap is large enough for all inserts */
+	buf.data = (uint32_t *)malloc((len + inserts) * sizeof(*buf.data));
+	assert(buf.data);
+
+	for (i = 0; i < len; i++)
+		buf.data[inserts + i] = (uint32_t)i;
+	buf.start = 0;
+	buf.end = inserts;
+
+	bench_pos_init(&pos, len, local);
+	start = bench_now();
+	for (i = len; i < len + inserts; i++)
+		gapbuffer_insert(&buf, bench_pos_next(&pos, i), (uint32_t)i);
+
+	snprintf(label, sizeof(label), "%8lu %s: gap buffer",
+		 (unsigned long)len, local ? "local " : "random");
+	bench_report(label, inserts, bench_now() - start);
+	bench_consume(buf.data[len / 2]);
+
+	free(buf.data);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t scale = bench_scale(argc, argv);
+	size_t moves;
+	size_t len;
+
+	for (len = 100000; len <= 10000000; len *= 10) {
+		moves = BENCH_ARRAY_MOVES / len * scale;
+
+		bench_rope(len, BENCH_ROPE_INSERTS * scale, false);
+		bench_vector(len, moves, false);
+		bench_gapbuffer(len, moves, false);
+
+		bench_rope(len, BENCH_ROPE_INSERTS * scale, true);
+		bench_vector(len, moves, true);
+		bench_gapbuffer(len, BENCH_ROPE_INSERTS * scale, true);
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+#include "common-runqueue.h"
+
+/* each task runs between 1 and 4 time slices before the next decision */
+#define BENCH_SLICE 1000
+#define BENCH_DECISIONS 1000000
+
+static int avl_task_cmp(const struct avl_node *a, const struct avl_node *b)
+{
+	uint64_t vruntime_a = avl_task_vruntime(a);
+	uint64_t vruntime_b = avl_task_vruntime(b);
+
+	if (vruntime_a < vruntime_b)
+		return -1;
+	else if (vruntime_a > vruntime_b)
+		return 1;
+	else
+		return 0;
+}
+
+static void bench_fill(struct avl_runqueue *rq, struct avl_task *tasks,
+		       size_t count, uint32_t *seed)
+{
+	size_t i;
+
+	avl_runqueue_init(rq);
+	for (i = 0; i < count; i++) {
+		tasks[i].vruntime = bench_random(seed) % (count * BENCH_SLICE);
+		avl_runqueue_enqueue(rq, &tasks[i]);
+	}
+}
+
+static uint64_t bench_delta(uint32_t *seed)
+{
+	return BENCH_SLICE + bench_random(seed) % (3 * BENCH_SLICE);
+}
+
+static void bench_run(size_t count, size_t decisions)
+{
+	struct avl_runqueue rq;
+	struct avl_task *tasks;
+	struct avl_task *task;
+	struct avl_node *node;
+	char label[64];
+	uint32_t seed;
+	uint64_t start;
+	uint64_t ns;
+	size_t i;
+
+	tasks = (struct avl_task *)malloc(count * sizeof(*tasks));
+	assert(tasks);
+
+	seed = 1;
+	bench_fill(&rq, tasks, count, &seed);
+
+	start = bench_now();
+	for (i = 0; i < decisions; i++) {
+		task = avl_runqueue_pick_requeue(&rq, bench_delta(&seed));
+		bench_consume((uintptr_t)task);
+	}
+	ns = bench_now() - start;
+
+	snprintf(label, sizeof(label), "%7lu tasks: avl_runqueue_pick_requeue",
+		 (unsigned long)count);
+	bench_report(label, decisions, ns);
+
+	/* same decisions without cached leftmost node and climb from it */
+	seed = 1;
+	bench_fill(&rq, tasks, count, &seed);
+
+	start = bench_now();
+	for (i = 0; i < decisions; i++) {
+		node = avl_first(&rq.root);
+		task = avl_entry(node, struct avl_task, avl);
+		avl_erase(node, &rq.root);
+		task->vruntime += bench_delta(&seed);
+		avl_add(node, &rq.root, avl_task_cmp);
+		bench_consume((uintptr_t)task);
+	}
+	ns = bench_now() - start;
+
+	snprintf(label, sizeof(label), "%7lu tasks: avl_first+erase+add",
+		 (unsigned long)count);
+	bench_report(label, decisions, ns);
+
+	free(tasks);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t decisions = BENCH_DECISIONS * bench_scale(argc, argv);
+	size_t count;
+
+	for (count = 1000; count <= 100000; count *= 10)
+		bench_run(count, decisions);
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime and pthread_join with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+#include "common-sharded.h"
+
+struct bench_worker {
+	pthread_t thread;
+	struct avlitem *items;
+	size_t count;
+};
+
+static struct avl_shard shards[16];
+static struct avl_sharded bench_map;
+
+static void *bench_worker_run(void *arg)
+{
+	struct bench_worker *worker = (struct bench_worker *)arg;
+	size_t i;
+
+	for (i = 0; i < worker->count; i++)
+		avl_sharded_insert(&bench_map, &worker->items[i]);
+
+	for (i = 0; i < worker->count; i++)
+		avl_sharded_erase(&bench_map, &worker->items[i]);
+
+	return NULL;
+}
+
+static void bench_run(size_t nshards, size_t threads, struct avlitem *items,
+		      size_t count)
+{
+	struct bench_worker *workers;
+	char label[64];
+	uint64_t start;
+	uint64_t ns;
+	size_t i;
+	int ret;
+
+	avl_sharded_init(&bench_map, shards, nshards, 65536, false);
+
+	workers = (struct bench_worker *)malloc(threads * sizeof(*workers));
+	assert(workers);
+
+	for (i = 0; i < threads; i++) {
+		workers[i].items = &items[i * (count / threads)];
+		workers[i].count = count / threads;
+	}
+
+	start = bench_now();
+	for (i = 0; i < threads; i++) {
+		ret = pthread_create(&workers[i].thread, NULL,
+				     bench_worker_run, &workers[i]);
+		assert(ret == 0);
+	}
+
+	for (i = 0; i < threads; i++) {
+		ret = pthread_join(workers[i].thread, NULL);
+		assert(ret == 0);
+	}
+	ns = bench_now() - start;
+	(void)ret;
+
+	/* aggregated time per operation drops when the threads scale */
+	snprintf(label, sizeof(label),
+		 "%2lu shards, %2lu threads: insert+erase",
+		 (unsigned long)nshards, (unsigned long)threads);
+	bench_report(label, 2 * (count / threads) * threads, ns);
+
+	free(workers);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = 262144 * bench_scale(argc, argv);
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t seed = 1;
+	struct avlitem *items;
+	size_t threads;
+	size_t i;
+
+	items = (struct avlitem *)malloc(count * sizeof(*items));
+	assert(items);
+
+	for (i = 0; i < count; i++)
+		items[i].i = (uint16_t)bench_random(&seed);
+
+#ifndef AVLTREE_ATOMIC_USE
+	/* shard locks are not thread-safe without atomics */
+	cpus = 1;
+#endif
+
+	/* spinning on a preempted lock holder only measures the scheduler */
+	for (threads = 1; threads == 1 || (long)threads <= cpus; threads *= 2) {
+		bench_run(1, threads, items, count);
+		bench_run(ARRAY_SIZE(shards), threads, items, count);
+	}
+
+	free(items);
+
+	return 0;
+}
@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: MIT
+/* Minimal AVL-tree helper functions benchmark
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+/* clock_gettime with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-bench.h"
+#include "common-timerqueue.h"
+
+/* every timer is periodic with a random period. Each tick additionally
+ * rearms some random pending timers (e.g. reset network timeouts)
+ */
+#define BENCH_TICKS 65536
+#define BENCH_REARMS 16
+#define BENCH_PERIOD 65536
+
+struct heaptimer {
+	uint64_t expires;
+	size_t index;
+};
+
+struct heap {
+	struct heaptimer **timers;
+	size_t size;
+};
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1U << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+struct wheeltimer {
+	uint64_t expires;
+	struct wheeltimer *next;
+	struct wheeltimer **pprev;
+};
+
+/* hierarchical timing wheel with cascading of the higher levels. @base is
+ * the next tick which was not yet processed
+ */
+struct wheel {
+	struct wheeltimer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	uint64_t base;
+};
+
+static struct avl_timerqueue bench_queue;
+static uint64_t bench_clock;
+static uint32_t bench_seed;
+static size_t bench_expired;
+
+static uint64_t bench_expires(void)
+{
+	return bench_clock + 1 + bench_random(&bench_seed) % (BENCH_PERIOD - 1);
+}
+
+static size_t bench_pick(size_t count)
+{
+	return bench_random(&bench_seed) % count;
+}
+
+static void bench_start(void)
+{
+	bench_clock = 0;
+	bench_seed = 1;
+	bench_expired = 0;
+}
+
+static void bench_finish(const char *name, size_t count, uint64_t ns)
+{
+	char label[64];
+	size_t ops;
+
+	ops = bench_expired + BENCH_TICKS * BENCH_REARMS;
+
+	snprintf(label, sizeof(label), "%9lu timers: %s", (unsigned long)count,
+		 name);
+	bench_report(label, ops, ns);
+}
+
+static void bench_avl_expired(struct avl_timer *timer)
+{
+	avl_timerqueue_rearm(&bench_queue, timer, bench_expires());
+	bench_expired++;
+}
+
+static void bench_avl(size_t count)
+{
+	struct avl_timer *timers;
+	uint64_t start;
+	size_t i;
+
+	timers = (struct avl_timer *)malloc(count * sizeof(*timers));
+	assert(timers);
+
+	bench_start();
+	avl_timerqueue_init(&bench_queue);
+	for (i = 0; i < count; i++) {
+		avl_timer_init(&timers[i]);
+		avl_timerqueue_rearm(&bench_queue, &timers[i], bench_expires());
+	}
+
+	start = bench_now();
+	for (bench_clock = 1; bench_clock <= BENCH_TICKS; bench_clock++) {
+		avl_timerqueue_expire(&bench_queue, bench_clock,
+				      bench_avl_expired);
+
+		for (i = 0; i < BENCH_REARMS; i++)
+			avl_timerqueue_rearm(&bench_queue,
+					     &timers[bench_pick(count)],
+					     bench_expires());
+	}
+	bench_finish("avl_timerqueue", count, bench_now() - start);
+
+	free(timers);
+}
+
+static void heap_set(struct heap *heap, size_t index, struct heaptimer *timer)
+{
+	heap->timers[index] = timer;
+	timer->index = index;
+}
+
+static void heap_up(struct heap *heap, size_t index)
+{
+	struct heaptimer *timer = heap->timers[index];
+	size_t parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (heap->timers[parent]->expires <= timer->expires)
+			break;
+
+		heap_set(heap, index, heap->timers[parent]);
+		index = parent;
+	}
+
+	heap_set(heap, index, timer);
+}
+
+static void heap_down(struct heap *heap, size_t index)
+{
+	struct heaptimer *timer = heap->timers[index];
+	struct heaptimer **timers = heap->timers;
+	size_t child;
+
+	while ((child = 2 * index + 1) < heap->size) {
+		if (child + 1 < heap->size &&
+		    timers[child + 1]->expires < timers[child]->expires)
+			child++;
+
+		if (timer->expires <= timers[child]->expires)
+			break;
+
+		heap_set(heap, index, timers[child]);
+		index = child;
+	}
+
+	heap_set(heap, index, timer);
+}
+
+static void heap_rearm(struct heap *heap, struct heaptimer *timer,
+		       uint64_t expires)
+{
+	timer->expires = expires;
+	heap_up(heap, timer->index);
+	heap_down(heap, timer->index);
+}
+
+static void bench_heap(size_t count)
+{
+	struct heaptimer *timers;
+	struct heaptimer *timer;
+	struct heap heap;
+	uint64_t start;
+	size_t i;
+
+	timers = (struct heaptimer *)malloc(count * sizeof(*timers));
+	heap.timers = (struct heaptimer **)malloc(count * sizeof(*heap.timers));
+	assert(timers);
+	assert(heap.timers);
+
+	bench_start();
+	heap.size = 0;
+	for (i = 0; i < count; i++) {
+		timers[i].expires = bench_expires();
+		heap_set(&heap, heap.size++, &timers[i]);
+		heap_up(&heap, timers[i].index);
+	}
+
+	start = bench_now();
+	for (bench_clock = 1; bench_clock <= BENCH_TICKS; bench_clock++) {
+		/* expired periodic timers are rearmed directly at the top */
+		while (heap.timers[0]->expires <= bench_clock) {
+			timer = heap.timers[0];
+			timer->expires = bench_expires();
+			heap_down(&heap, 0);
+			bench_expired++;
+		}
+
+		for (i = 0; i < BENCH_REARMS; i++)
+			heap_rearm(&heap, &timers[bench_pick(count)],
+				   bench_expires());
+	}
+	bench_finish("binary heap", count, bench_now() - start);
+
+	free(heap.timers);
+	free(timers);
+}
+
+static void wheel_add(struct wheel *wheel, struct wheeltimer *timer)
+{
+	uint64_t expires = timer->expires;
+	struct wheeltimer **slot;
+	uint64_t delta;
+	size_t level;
+
+	if (expires < wheel->base)
+		expires = wheel->base;
+
+	delta = expires - wheel->base;
+	for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+		if (delta < (uint64_t)1 << (WHEEL_BITS * (level + 1)))
+			break;
+	}
+
+	slot = &wheel->slots[level][(expires >> (WHEEL_BITS * level)) &
+				    WHEEL_MASK];
+
+	timer->next = *slot;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	timer->pprev = slot;
+	*slot = timer;
+}
+
+static void wheel_del(struct wheeltimer *timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+}
+
+static void wheel_rearm(struct wheel *wheel, struct wheeltimer *timer,
+			uint64_t expires)
+{
+	wheel_del(timer);
+	timer->expires = expires;
+	wheel_add(wheel, timer);
+}
+
+static struct wheeltimer *wheel_detach(struct wheel *wheel, size_t level,
+				       size_t index)
+{
+	struct wheeltimer *list = wheel->slots[level][index];
+
+	wheel->slots[level][index] = NULL;
+
+	return list;
+}
+
+/* move the timers of the upper level slot down to the finer levels */
+static size_t wheel_cascade(struct wheel *wheel, size_t level)
+{
+	size_t index = (wheel->base >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct wheeltimer *timer;
+	struct wheeltimer *list;
+
+	list = wheel_detach(wheel, level, index);
+	while (list) {
+		timer = list;
+		list = timer->next;
+		wheel_add(wheel, timer);
+	}
+
+	return index;
+}
+
+static void wheel_expire(struct wheel *wheel, uint64_t now)
+{
+	struct wheeltimer *timer;
+	struct wheeltimer *list;
+	size_t index;
+	size_t level;
+
+	while (wheel->base <= now) {
+		index = wheel->base & WHEEL_MASK;
+
+		for (level = 1; !index && level < WHEEL_LEVELS; level++)
+			index = wheel_cascade(wheel, level);
+
+		list = wheel_detach(wheel, 0, wheel->base & WHEEL_MASK);
+		wheel->base++;
+
+		while (list) {
+			timer = list;
+			list = timer->next;
+
+			timer->expires = bench_expires();
+			wheel_add(wheel, timer);
+			bench_expired++;
+		}
+	}
+}
+
+static void bench_wheel(size_t count)
+{
+	struct wheeltimer *timers;
+	struct wheel *wheel;
+	uint64_t start;
+	size_t i;
+
+	timers = (struct wheeltimer *)malloc(count * sizeof(*timers));
+	wheel = (struct wheel *)calloc(1, sizeof(*wheel));
+	assert(timers);
+	assert(wheel);
+
+	bench_start();
+	wheel->base = 1;
+	for (i = 0; i < count; i++) {
+		timers[i].expires = bench_expires();
+		wheel_add(wheel, &timers[i]);
+	}
+
+	start = bench_now();
+	for (bench_clock = 1; bench_clock <= BENCH_TICKS; bench_clock++) {
+		wheel_expire(wheel, bench_clock);
+
+		for (i = 0; i < BENCH_REARMS; i++)
+			wheel_rearm(wheel, &timers[bench_pick(count)],
+				    bench_expires());
+	}
+	bench_finish("timing wheel", count, bench_now() - start);
+
+	free(wheel);
+	free(timers);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t scale = bench_scale(argc, argv);
+	size_t count;
+
+	for (count = 65536; count <= 1048576; count *= 16) {
+		bench_avl(count * scale);
+		bench_heap(count * scale);
+		bench_wheel(count * scale);
+	}
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_BENCH_H__
+#define __AVLTREE_COMMON_BENCH_H__
+
+/* benchmarks have to define _POSIX_C_SOURCE for clock_gettime before any
+ * include. They are only built by "make" and run by "make bench" (with
+ * optimizations via CFLAGS=-O2 and optional BENCH_SCALE=<n>)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../avltree.h"
+
+struct benchitem {
+	uint32_t key;
+	struct avl_node avl;
+};
+
+static __inline__ uint64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/* cpu time of the calling thread, not affected by other threads on its cpu */
+static __inline__ uint64_t bench_cpu_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/* multiplier for the default sizes of a benchmark (first argument) */
+static __inline__ size_t bench_scale(int argc, char *argv[])
+{
+	unsigned long scale;
+
+	if (argc < 2)
+		return 1;
+
+	scale = strtoul(argv[1], NULL, 10);
+	if (!scale)
+		return 1;
+
+	return scale;
+}
+
+static __inline__ uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+static __inline__ void bench_report(const char *name, size_t ops,
+				    uint64_t ns)
+{
+	double ns_per_op = 0.0;
+
+	if (ops)
+		ns_per_op = (double)ns / (double)ops;
+
+	printf("%-48s %10lu ops %10.1f ns/op\n", name, (unsigned long)ops,
+	       ns_per_op);
+}
+
+static volatile uintptr_t bench_sink;
+
+/* keep a result alive so the measured work is not optimized away */
+static __inline__ void bench_consume(uintptr_t value)
+{
+	bench_sink = value;
+}
+
+static __inline__ int benchitem_cmp(const struct avl_node *a,
+				    const struct avl_node *b)
+{
+	const struct benchitem *item_a;
+	const struct benchitem *item_b;
+
+	item_a = avl_entry(a, const struct benchitem, avl);
+	item_b = avl_entry(b, const struct benchitem, avl);
+
+	if (item_a->key < item_b->key)
+		return -1;
+	else if (item_a->key > item_b->key)
+		return 1;
+	else
+		return 0;
+}
+
+static __inline__ struct benchitem *benchitem_find(const struct avl_root *root,
+						   uint32_t key)
+{
+	struct benchitem *cur_entry;
+	struct avl_node *node;
+
+	node = avl_load_node(&root->node);
+	while (node) {
+		cur_entry = avl_entry(node, struct benchitem, avl);
+
+		if (key == cur_entry->key)
+			return cur_entry;
+
+		if (key < cur_entry->key)
+			node = avl_load_node(&node->left);
+		else
+			node = avl_load_node(&node->right);
+	}
+
+	return NULL;
+}
+
+#endif /* __AVLTREE_COMMON_BENCH_H__ */
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_BLOOMFILTER_H__
+#define __AVLTREE_COMMON_BLOOMFILTER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+
+#define AVL_BLOOM_HASHES 3
+
+/* tree with counting bloom filter. The number of counters must be a power of
+ * two. A saturated counter is never decremented again
+ */
+struct avl_bloomtree {
+	struct avl_root root;
+	uint8_t *counters;
+	size_t ncounters;
+};
+
+static __inline__ size_t avl_bloomtree_counter(const struct avl_bloomtree *tree,
+					       uint16_t key, size_t i)
+{
+	uint32_t hash1 = key * UINT32_C(2654435761);
+	uint32_t hash2 = (key ^ UINT32_C(0x5bd1e995)) * UINT32_C(0x9e3779b1);
+
+	hash1 ^= hash1 >> 15;
+	hash2 ^= hash2 >> 13;
+
+	/* double hashing for the independent counters */
+	return (size_t)(hash1 + i * (hash2 | 1)) & (tree->ncounters - 1);
+}
+
+static __inline__ void avl_bloomtree_init(struct avl_bloomtree *tree,
+					  uint8_t *counters, size_t ncounters)
+{
+	size_t i;
+
+	INIT_AVL_ROOT(&tree->root);
+	tree->counters = counters;
+	tree->ncounters = ncounters;
+
+	for (i = 0; i < ncounters; i++)
+		counters[i] = 0;
+}
+
+static __inline__ bool avl_bloomtree_maybe(const struct avl_bloomtree *tree,
+					   uint16_t key)
+{
+	size_t i;
+
+	for (i = 0; i < AVL_BLOOM_HASHES; i++) {
+		if (!tree->counters[avl_bloomtree_counter(tree, key, i)])
+			return false;
+	}
+
+	return true;
+}
+
+static __inline__ void avl_bloomtree_insert(struct avl_bloomtree *tree,
+					    struct avlitem *new_entry)
+{
+	size_t counter;
+	size_t i;
+
+	for (i = 0; i < AVL_BLOOM_HASHES; i++) {
+		counter = avl_bloomtree_counter(tree, new_entry->i, i);
+		if (tree->counters[counter] != UINT8_MAX)
+			tree->counters[counter]++;
+	}
+
+	avlitem_insert_balanced(&tree->root, new_entry);
+}
+
+static __inline__ void avl_bloomtree_erase(struct avl_bloomtree *tree,
+					   struct avlitem *entry)
+{
+	size_t counter;
+	size_t i;
+
+	avl_erase(&entry->avl, &tree->root);
+
+	for (i = 0; i < AVL_BLOOM_HASHES; i++) {
+		counter = avl_bloomtree_counter(tree, entry->i, i);
+		if (tree->counters[counter] != UINT8_MAX)
+			tree->counters[counter]--;
+	}
+}
+
+/* definite misses return before the tree is touched */
+static __inline__ struct avlitem *avl_bloomtree_find(struct avl_bloomtree *tree,
+						     uint16_t key)
+{
+	if (!avl_bloomtree_maybe(tree, key))
+		return NULL;
+
+	return avlitem_find(&tree->root, key);
+}
+
+#endif /* __AVLTREE_COMMON_BLOOMFILTER_H__ */
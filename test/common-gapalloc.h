@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_GAPALLOC_H__
+#define __AVLTREE_COMMON_GAPALLOC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+/* allocated extent. gap is the free space between the end of the previous
+ * extent (or 0) and start. max_gap is the largest gap in the subtree
+ */
+struct avl_extent {
+	uint64_t start;
+	uint64_t len;
+	uint64_t gap;
+	uint64_t max_gap;
+	struct avl_node avl;
+};
+
+/* free space is never stored explicitly. It is always coalesced because it
+ * is derived from the neighboring extents
+ */
+struct avl_gapalloc {
+	struct avl_root root;
+	uint64_t size;
+};
+
+static __inline__ void avl_gapalloc_init(struct avl_gapalloc *alloc,
+					 uint64_t size)
+{
+	INIT_AVL_ROOT(&alloc->root);
+	alloc->size = size;
+}
+
+static __inline__ uint64_t avl_extent_max_gap(const struct avl_node *node)
+{
+	if (!node)
+		return 0;
+
+	return avl_entry(node, const struct avl_extent, avl)->max_gap;
+}
+
+static __inline__ void avl_extent_augment(struct avl_node *node)
+{
+	struct avl_extent *extent = avl_entry(node, struct avl_extent, avl);
+	uint64_t max_gap = extent->gap;
+
+	if (avl_extent_max_gap(node->left) > max_gap)
+		max_gap = avl_extent_max_gap(node->left);
+
+	if (avl_extent_max_gap(node->right) > max_gap)
+		max_gap = avl_extent_max_gap(node->right);
+
+	extent->max_gap = max_gap;
+}
+
+static __inline__ uint64_t avl_extent_end(const struct avl_node *node)
+{
+	const struct avl_extent *extent;
+
+	if (!node)
+		return 0;
+
+	extent = avl_entry(node, const struct avl_extent, avl);
+	return extent->start + extent->len;
+}
+
+/* lowest extent with a gap of at least len in front of it */
+static __inline__ struct avl_extent *
+avl_gapalloc_find_gap(const struct avl_gapalloc *alloc, uint64_t len)
+{
+	struct avl_node *node = alloc->root.node;
+	struct avl_extent *extent;
+
+	if (avl_extent_max_gap(node) < len)
+		return NULL;
+
+	while (node) {
+		extent = avl_entry(node, struct avl_extent, avl);
+
+		if (avl_extent_max_gap(node->left) >= len)
+			node = node->left;
+		else if (extent->gap >= len)
+			return extent;
+		else
+			node = node->right;
+	}
+
+	return NULL;
+}
+
+/* first-fit allocation of len bytes into extent */
+static __inline__ bool avl_gapalloc_alloc(struct avl_gapalloc *alloc,
+					  struct avl_extent *extent,
+					  uint64_t len)
+{
+	struct avl_node **cur_nodep = &alloc->root.node;
+	struct avl_node *parent = NULL;
+	struct avl_extent *next;
+	uint64_t last_end;
+
+	next = avl_gapalloc_find_gap(alloc, len);
+	if (next) {
+		extent->start = next->start - next->gap;
+	} else {
+		last_end = avl_extent_end(avl_last(&alloc->root));
+		if (alloc->size - last_end < len)
+			return false;
+
+		extent->start = last_end;
+	}
+
+	extent->len = len;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		if (extent->start < avl_entry(parent, struct avl_extent,
+					      avl)->start)
+			cur_nodep = &((*cur_nodep)->left);
+		else
+			cur_nodep = &((*cur_nodep)->right);
+	}
+
+	avl_link_node(&extent->avl, parent, cur_nodep);
+
+	/* the new extent always starts at the beginning of the gap */
+	extent->gap = 0;
+	extent->max_gap = 0;
+
+	if (next) {
+		next->gap -= len;
+		avl_augment_propagate(&next->avl, avl_extent_augment);
+	}
+
+	avl_insert_augmented(&extent->avl, &alloc->root, avl_extent_augment);
+
+	return true;
+}
+
+static __inline__ void avl_gapalloc_free(struct avl_gapalloc *alloc,
+					 struct avl_extent *extent)
+{
+	struct avl_node *next = avl_next(&extent->avl);
+	struct avl_extent *next_extent;
+
+	avl_erase_augmented(&extent->avl, &alloc->root, avl_extent_augment);
+
+	/* merge free space of extent with the gap in front of next */
+	if (next) {
+		next_extent = avl_entry(next, struct avl_extent, avl);
+		next_extent->gap += extent->gap + extent->len;
+		avl_augment_propagate(next, avl_extent_augment);
+	}
+}
+
+#endif /* __AVLTREE_COMMON_GAPALLOC_H__ */
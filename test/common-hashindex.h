@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_HASHINDEX_H__
+#define __AVLTREE_COMMON_HASHINDEX_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+
+/* tree with open addressing (linear probing) hash index of the same nodes.
+ * The number of slots must be a power of two and larger than the number of
+ * nodes
+ */
+struct avl_hashindex {
+	struct avl_root root;
+	struct avl_node **slots;
+	size_t nslots;
+};
+
+static __inline__ size_t avl_hashindex_hash(const struct avl_hashindex *index,
+					    uint16_t key)
+{
+	uint32_t hash = key * UINT32_C(2654435761);
+
+	hash ^= hash >> 16;
+
+	return (size_t)hash & (index->nslots - 1);
+}
+
+static __inline__ uint16_t avl_hashindex_key(const struct avl_node *node)
+{
+	return avl_entry(node, const struct avlitem, avl)->i;
+}
+
+static __inline__ void avl_hashindex_init(struct avl_hashindex *index,
+					  struct avl_node **slots,
+					  size_t nslots)
+{
+	size_t i;
+
+	INIT_AVL_ROOT(&index->root);
+	index->slots = slots;
+	index->nslots = nslots;
+
+	for (i = 0; i < nslots; i++)
+		slots[i] = NULL;
+}
+
+/* slot which contains the key or the empty slot at which the key would be
+ * stored
+ */
+static __inline__ size_t avl_hashindex_slot(const struct avl_hashindex *index,
+					    uint16_t key)
+{
+	size_t slot = avl_hashindex_hash(index, key);
+
+	while (index->slots[slot] &&
+	       avl_hashindex_key(index->slots[slot]) != key)
+		slot = (slot + 1) & (index->nslots - 1);
+
+	return slot;
+}
+
+/* keys must be unique */
+static __inline__ void avl_hashindex_insert(struct avl_hashindex *index,
+					    struct avlitem *new_entry)
+{
+	size_t slot = avl_hashindex_slot(index, new_entry->i);
+
+	avlitem_insert_balanced(&index->root, new_entry);
+	index->slots[slot] = &new_entry->avl;
+}
+
+static __inline__ struct avlitem *
+avl_hashindex_find(const struct avl_hashindex *index, uint16_t key)
+{
+	size_t slot = avl_hashindex_slot(index, key);
+
+	if (!index->slots[slot])
+		return NULL;
+
+	return avl_entry(index->slots[slot], struct avlitem, avl);
+}
+
+static __inline__ void avl_hashindex_erase(struct avl_hashindex *index,
+					   struct avlitem *entry)
+{
+	size_t mask = index->nslots - 1;
+	size_t slot = avl_hashindex_slot(index, entry->i);
+	size_t next;
+	size_t home;
+
+	avl_erase(&entry->avl, &index->root);
+	index->slots[slot] = NULL;
+
+	/* shift following entries of the probe sequence back into the hole
+	 * instead of leaving a tombstone
+	 */
+	for (next = (slot + 1) & mask; index->slots[next];
+	     next = (next + 1) & mask) {
+		home = avl_hashindex_hash(index,
+					  avl_hashindex_key(index->slots[next]));
+
+		/* entry can only move when the hole is between home and next */
+		if (((next - home) & mask) < ((next - slot) & mask))
+			continue;
+
+		index->slots[slot] = index->slots[next];
+		index->slots[next] = NULL;
+		slot = next;
+	}
+}
+
+/* new_entry must have the same key as old_entry */
+static __inline__ void avl_hashindex_replace(struct avl_hashindex *index,
+					     struct avlitem *old_entry,
+					     struct avlitem *new_entry)
+{
+	size_t slot = avl_hashindex_slot(index, old_entry->i);
+
+	avl_replace_node(&old_entry->avl, &new_entry->avl, &index->root);
+	index->slots[slot] = &new_entry->avl;
+}
+
+#endif /* __AVLTREE_COMMON_HASHINDEX_H__ */
@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_RANGETREE_H__
+#define __AVLTREE_COMMON_RANGETREE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+/* point in primary tree ordered by x. ys contains all points of the subtree
+ * sorted by y
+ */
+struct avl_point {
+	uint16_t x;
+	uint16_t y;
+	struct avl_node avl;
+	struct avl_point **ys;
+	size_t count;
+};
+
+typedef void (*avl_point_report_t)(struct avl_point *point, void *priv);
+
+/* the tree is static. Modifications require a new avl_rangetree_build */
+struct avl_rangetree {
+	struct avl_root root;
+};
+
+static __inline__ int avl_point_cmp(const struct avl_node *a,
+				    const struct avl_node *b)
+{
+	const struct avl_point *point_a = avl_entry(a, const struct avl_point,
+						    avl);
+	const struct avl_point *point_b = avl_entry(b, const struct avl_point,
+						    avl);
+
+	return cmpint(&point_a->x, &point_b->x);
+}
+
+static __inline__ struct avl_point *avl_point_child(const struct avl_node *node)
+{
+	if (!node)
+		return NULL;
+
+	return avl_entry(node, struct avl_point, avl);
+}
+
+/* number of entries required in the ys pools of all subtrees */
+static __inline__ size_t avl_rangetree_pool_needed(const struct avl_node *node,
+						   size_t *count)
+{
+	size_t count_left = 0;
+	size_t count_right = 0;
+	size_t needed;
+
+	if (!node) {
+		*count = 0;
+		return 0;
+	}
+
+	needed = avl_rangetree_pool_needed(node->left, &count_left);
+	needed += avl_rangetree_pool_needed(node->right, &count_right);
+
+	*count = 1 + count_left + count_right;
+
+	return needed + *count;
+}
+
+/* post-order merge of the y sorted arrays of both children */
+static __inline__ size_t avl_rangetree_fill(struct avl_node *node,
+					    struct avl_point **pool)
+{
+	struct avl_point *point = avl_entry(node, struct avl_point, avl);
+	struct avl_point *left = avl_point_child(node->left);
+	struct avl_point *right = avl_point_child(node->right);
+	struct avl_point *next;
+	size_t count_left = 0;
+	size_t count_right = 0;
+	size_t used = 0;
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	bool self = true;
+
+	if (left) {
+		used += avl_rangetree_fill(node->left, &pool[used]);
+		count_left = left->count;
+	}
+
+	if (right) {
+		used += avl_rangetree_fill(node->right, &pool[used]);
+		count_right = right->count;
+	}
+
+	point->ys = &pool[used];
+	point->count = 1 + count_left + count_right;
+
+	while (i < count_left || j < count_right) {
+		if (j == count_right ||
+		    (i < count_left && left->ys[i]->y <= right->ys[j]->y))
+			next = left->ys[i++];
+		else
+			next = right->ys[j++];
+
+		if (self && point->y < next->y) {
+			point->ys[k++] = point;
+			self = false;
+		}
+
+		point->ys[k++] = next;
+	}
+
+	if (self)
+		point->ys[k] = point;
+
+	return used + point->count;
+}
+
+/* nodes are sorted by x and build with the bulk loader. pool must have
+ * space for the y sorted arrays of all subtrees (about n * height entries)
+ */
+static __inline__ bool avl_rangetree_build(struct avl_rangetree *tree,
+					   struct avl_node **nodes, size_t n,
+					   struct avl_point **pool,
+					   size_t pool_size)
+{
+	size_t count;
+
+	INIT_AVL_ROOT(&tree->root);
+	avl_bulk_load(&tree->root, nodes, n, avl_point_cmp);
+
+	if (avl_rangetree_pool_needed(tree->root.node, &count) > pool_size) {
+		INIT_AVL_ROOT(&tree->root);
+		return false;
+	}
+
+	if (tree->root.node)
+		avl_rangetree_fill(tree->root.node, pool);
+
+	return true;
+}
+
+static __inline__ void avl_point_report(struct avl_point *point,
+					uint16_t y1, uint16_t y2,
+					avl_point_report_t report, void *priv)
+{
+	if (point->y >= y1 && point->y <= y2)
+		report(point, priv);
+}
+
+/* binary search for y1 in the y sorted array of a subtree */
+static __inline__ void avl_rangetree_report_ys(const struct avl_node *node,
+					       uint16_t y1, uint16_t y2,
+					       avl_point_report_t report,
+					       void *priv)
+{
+	const struct avl_point *point = avl_point_child(node);
+	size_t lo = 0;
+	size_t hi;
+	size_t mid;
+
+	if (!point)
+		return;
+
+	hi = point->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (point->ys[mid]->y < y1)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < point->count && point->ys[lo]->y <= y2; lo++)
+		report(point->ys[lo], priv);
+}
+
+/* report all points in [x1, x2] x [y1, y2] in O(log^2 n + k) */
+static __inline__ void
+avl_rangetree_query(const struct avl_rangetree *tree, uint16_t x1,
+		    uint16_t x2, uint16_t y1, uint16_t y2,
+		    avl_point_report_t report, void *priv)
+{
+	struct avl_node *split = tree->root.node;
+	struct avl_point *point;
+	struct avl_node *node;
+
+	/* find the first node in the x range */
+	while (split) {
+		point = avl_entry(split, struct avl_point, avl);
+
+		if (point->x < x1)
+			split = split->right;
+		else if (point->x > x2)
+			split = split->left;
+		else
+			break;
+	}
+
+	if (!split)
+		return;
+
+	avl_point_report(point, y1, y2, report, priv);
+
+	/* right subtrees along the path to x1 are completely in range */
+	for (node = split->left; node;) {
+		point = avl_entry(node, struct avl_point, avl);
+
+		if (point->x < x1) {
+			node = node->right;
+			continue;
+		}
+
+		avl_point_report(point, y1, y2, report, priv);
+		avl_rangetree_report_ys(node->right, y1, y2, report, priv);
+		node = node->left;
+	}
+
+	/* left subtrees along the path to x2 are completely in range */
+	for (node = split->right; node;) {
+		point = avl_entry(node, struct avl_point, avl);
+
+		if (point->x > x2) {
+			node = node->left;
+			continue;
+		}
+
+		avl_point_report(point, y1, y2, report, priv);
+		avl_rangetree_report_ys(node->left, y1, y2, report, priv);
+		node = node->right;
+	}
+}
+
+#endif /* __AVLTREE_COMMON_RANGETREE_H__ */
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_RUNQUEUE_H__
+#define __AVLTREE_COMMON_RUNQUEUE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+struct avl_task {
+	uint64_t vruntime;
+	struct avl_node avl;
+};
+
+/* the leftmost task is cached and min_vruntime never decreases. Per-core
+ * run-queues are just one avl_runqueue per core
+ */
+struct avl_runqueue {
+	struct avl_root root;
+	struct avl_node *leftmost;
+	uint64_t min_vruntime;
+	size_t nr_running;
+};
+
+static __inline__ void avl_runqueue_init(struct avl_runqueue *rq)
+{
+	INIT_AVL_ROOT(&rq->root);
+	rq->leftmost = NULL;
+	rq->min_vruntime = 0;
+	rq->nr_running = 0;
+}
+
+static __inline__ uint64_t avl_task_vruntime(const struct avl_node *node)
+{
+	return avl_entry(node, const struct avl_task, avl)->vruntime;
+}
+
+static __inline__ void avl_runqueue_update_min(struct avl_runqueue *rq)
+{
+	uint64_t vruntime;
+
+	if (!rq->leftmost)
+		return;
+
+	vruntime = avl_task_vruntime(rq->leftmost);
+	if (vruntime > rq->min_vruntime)
+		rq->min_vruntime = vruntime;
+}
+
+/* insert below @start which must be an ancestor (or leftmost node) whose
+ * right subtree contains the position for @task. Tasks with equal vruntime
+ * are added after the existing ones
+ */
+static __inline__ void avl_runqueue_link(struct avl_runqueue *rq,
+					 struct avl_node *start,
+					 struct avl_task *task)
+{
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodep = &rq->root.node;
+	bool isleftmost = true;
+
+	if (start) {
+		parent = start;
+		cur_nodep = &start->right;
+		isleftmost = false;
+	}
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		if (task->vruntime < avl_task_vruntime(parent)) {
+			cur_nodep = &((*cur_nodep)->left);
+		} else {
+			cur_nodep = &((*cur_nodep)->right);
+			isleftmost = false;
+		}
+	}
+
+	if (isleftmost)
+		rq->leftmost = &task->avl;
+
+	avl_insert(&task->avl, parent, cur_nodep, &rq->root);
+	rq->nr_running++;
+}
+
+static __inline__ void avl_runqueue_enqueue(struct avl_runqueue *rq,
+					    struct avl_task *task)
+{
+	avl_runqueue_link(rq, NULL, task);
+	avl_runqueue_update_min(rq);
+}
+
+static __inline__ void avl_runqueue_dequeue(struct avl_runqueue *rq,
+					    struct avl_task *task)
+{
+	if (rq->leftmost == &task->avl)
+		rq->leftmost = avl_next(&task->avl);
+
+	avl_erase(&task->avl, &rq->root);
+	rq->nr_running--;
+	avl_runqueue_update_min(rq);
+}
+
+static __inline__ struct avl_task *
+avl_runqueue_pick(const struct avl_runqueue *rq)
+{
+	if (!rq->leftmost)
+		return NULL;
+
+	return avl_entry(rq->leftmost, struct avl_task, avl);
+}
+
+/* charge @delta to the leftmost task and requeue it. The new position is
+ * searched upwards from the new leftmost node instead of from the root, so
+ * the cost depends on how far the task moves
+ */
+static __inline__ struct avl_task *
+avl_runqueue_pick_requeue(struct avl_runqueue *rq, uint64_t delta)
+{
+	struct avl_task *task = avl_runqueue_pick(rq);
+	struct avl_node *start;
+	struct avl_node *parent;
+
+	if (!task)
+		return NULL;
+
+	task->vruntime += delta;
+
+	start = avl_next(&task->avl);
+	if (!start || task->vruntime < avl_task_vruntime(start)) {
+		avl_runqueue_update_min(rq);
+		return task;
+	}
+
+	avl_erase(&task->avl, &rq->root);
+	rq->nr_running--;
+	rq->leftmost = start;
+
+	/* the ancestors of the leftmost node have increasing vruntimes */
+	for (parent = avl_parent(start); parent; parent = avl_parent(start)) {
+		if (task->vruntime < avl_task_vruntime(parent))
+			break;
+
+		start = parent;
+	}
+
+	avl_runqueue_link(rq, start, task);
+	avl_runqueue_update_min(rq);
+
+	return task;
+}
+
+/* move the task with the largest vruntime from @src to @dst when @src has
+ * more tasks. Its vruntime is made relative to the min_vruntime of @dst
+ */
+static __inline__ struct avl_task *avl_runqueue_steal(struct avl_runqueue *dst,
+						      struct avl_runqueue *src)
+{
+	struct avl_node *node;
+	struct avl_task *task;
+
+	if (src->nr_running <= dst->nr_running + 1)
+		return NULL;
+
+	node = avl_last(&src->root);
+	task = avl_entry(node, struct avl_task, avl);
+	avl_runqueue_dequeue(src, task);
+
+	task->vruntime = task->vruntime - src->min_vruntime +
+			 dst->min_vruntime;
+	avl_runqueue_enqueue(dst, task);
+
+	return task;
+}
+
+#endif /* __AVLTREE_COMMON_RUNQUEUE_H__ */
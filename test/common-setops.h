@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_SETOPS_H__
+#define __AVLTREE_COMMON_SETOPS_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../avltree.h"
+#include "common.h"
+#include "common-treeops.h"
+#include "common-treevalidation.h"
+
+static uint16_t values[256];
+static uint8_t in_a[ARRAY_SIZE(values)];
+static uint8_t in_b[ARRAY_SIZE(values)];
+static uint8_t dropped[2][ARRAY_SIZE(values)];
+
+static struct avlitem items_a[ARRAY_SIZE(values)];
+static struct avlitem items_b[ARRAY_SIZE(values)];
+static uint8_t setops_skiplist[ARRAY_SIZE(values)];
+
+/* returns whether a node of a stays depending on whether b has its key */
+typedef bool (*setops_keep_t)(bool in_b);
+
+static void setops_drop(struct avl_node *node)
+{
+	struct avlitem *item = avl_entry(node, struct avlitem, avl);
+
+	if (item == &items_a[item->i]) {
+		assert(!dropped[0][item->i]);
+		dropped[0][item->i] = 1;
+	} else {
+		assert(item == &items_b[item->i]);
+		assert(!dropped[1][item->i]);
+		dropped[1][item->i] = 1;
+	}
+}
+
+/* both trees get separate items for the selected keys in random order */
+static __inline__ void setops_fill(struct avl_root *a, struct avl_root *b)
+{
+	size_t j;
+
+	memset(dropped, 0, sizeof(dropped));
+	INIT_AVL_ROOT(a);
+	INIT_AVL_ROOT(b);
+
+	random_shuffle_array(values, (uint16_t)ARRAY_SIZE(values));
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		items_a[values[j]].i = values[j];
+		items_b[values[j]].i = values[j];
+
+		if (in_a[values[j]])
+			avlitem_insert_balanced(a, &items_a[values[j]]);
+		if (in_b[values[j]])
+			avlitem_insert_balanced(b, &items_b[values[j]]);
+	}
+}
+
+static __inline__ void setops_prepare(struct avl_root *a, struct avl_root *b,
+				      unsigned int round)
+{
+	uint16_t mod_a = 2 + round % 7;
+	uint16_t mod_b = 2 + round % 5;
+	size_t j;
+
+	/* alternate between sparse, dense and very unequal trees */
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		in_a[j] = get_unsigned16() % mod_a != 0;
+		in_b[j] = get_unsigned16() % mod_b == 0;
+
+		if (round % 4 == 1)
+			in_b[j] = in_b[j] && j < 16;
+		if (round % 4 == 2)
+			in_a[j] = in_a[j] && j >= 200;
+	}
+
+	setops_fill(a, b);
+}
+
+enum setops_case {
+	SETOPS_EMPTY_A,
+	SETOPS_EMPTY_B,
+	SETOPS_DISJOINT,
+	SETOPS_IDENTICAL
+};
+
+static __inline__ void setops_prepare_case(struct avl_root *a,
+					   struct avl_root *b,
+					   enum setops_case setops_case)
+{
+	uint8_t selected;
+	size_t j;
+
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		selected = get_unsigned16() % 2;
+
+		switch (setops_case) {
+		case SETOPS_EMPTY_A:
+			in_a[j] = 0;
+			in_b[j] = selected;
+			break;
+		case SETOPS_EMPTY_B:
+			in_a[j] = selected;
+			in_b[j] = 0;
+			break;
+		case SETOPS_DISJOINT:
+			/* interleaved keys, each key is in exactly one tree */
+			in_a[j] = selected;
+			in_b[j] = !selected;
+			break;
+		case SETOPS_IDENTICAL:
+			in_a[j] = selected;
+			in_b[j] = selected;
+			break;
+		}
+	}
+
+	setops_fill(a, b);
+}
+
+/* check a after an operation which only drops nodes of a and which must not
+ * modify b. b can also be the same tree as a
+ */
+static __inline__ void setops_check_filter(struct avl_root *a,
+					   struct avl_root *b,
+					   setops_keep_t keep)
+{
+	const uint8_t *in_other = a == b ? in_a : in_b;
+	struct avlitem *item;
+	bool stays;
+	size_t j;
+
+	for (j = 0; j < ARRAY_SIZE(values); j++) {
+		stays = in_a[j] && keep(in_other[j]);
+		setops_skiplist[j] = !stays;
+		assert(dropped[0][j] == (in_a[j] && !stays));
+		assert(!dropped[1][j]);
+
+		item = avlitem_find(a, (uint16_t)j);
+		assert(item == (stays ? &items_a[j] : NULL));
+	}
+
+	check_root_order(a, setops_skiplist,
+			 (uint16_t)ARRAY_SIZE(setops_skiplist));
+	check_depth(a);
+
+	if (a == b)
+		return;
+
+	for (j = 0; j < ARRAY_SIZE(values); j++)
+		setops_skiplist[j] = !in_b[j];
+
+	check_root_order(b, setops_skiplist,
+			 (uint16_t)ARRAY_SIZE(setops_skiplist));
+	check_depth(b);
+}
+
+#endif /* __AVLTREE_COMMON_SETOPS_H__ */
@@ -0,0 +1,310 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_SHARDED_H__
+#define __AVLTREE_COMMON_SHARDED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+#define AVL_SHARD_CACHELINE 64
+
+#if defined(__GNUC__)
+#define AVL_SHARD_ALIGNED __attribute__ ((aligned(AVL_SHARD_CACHELINE)))
+#elif defined(_MSC_VER)
+#define AVL_SHARD_ALIGNED __declspec(align(AVL_SHARD_CACHELINE))
+#else
+#define AVL_SHARD_ALIGNED
+#endif
+
+struct avl_shard {
+	struct avl_root root;
+	unsigned int lock;
+	char padding[AVL_SHARD_CACHELINE - sizeof(struct avl_root) -
+		     sizeof(unsigned int)];
+} AVL_SHARD_ALIGNED;
+
+struct avl_sharded {
+	struct avl_shard *shards;
+	size_t nshards;
+	uint32_t keyspace;
+	bool hashed;
+};
+
+/* range partitioned shards are concatenated and use one cursor per shard.
+ * The round robin distributed shards are merged with cursors as binary
+ * min-heap of the non-empty shard positions (O(log nshards) per element)
+ */
+struct avl_sharded_iter {
+	struct avl_sharded *map;
+	struct avl_node **cursors;
+	size_t shard;
+	size_t heap_size;
+};
+
+/* the shards can only be shared between threads with atomic support */
+static __inline__ void avl_shard_lock(struct avl_shard *shard)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	while (__atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&shard->lock, __ATOMIC_RELAXED))
+			;
+	}
+#else
+	*(volatile unsigned int *)&shard->lock = 1;
+#endif
+}
+
+static __inline__ void avl_shard_unlock(struct avl_shard *shard)
+{
+#ifdef AVLTREE_ATOMIC_USE
+	__atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+#else
+	*(volatile unsigned int *)&shard->lock = 0;
+#endif
+}
+
+/* keys below keyspace are range partitioned when hashed is false. Otherwise
+ * the keys are distributed round robin over the shards
+ */
+static __inline__ void avl_sharded_init(struct avl_sharded *map,
+					struct avl_shard *shards,
+					size_t nshards, uint32_t keyspace,
+					bool hashed)
+{
+	size_t i;
+
+	for (i = 0; i < nshards; i++) {
+		INIT_AVL_ROOT(&shards[i].root);
+		shards[i].lock = 0;
+	}
+
+	map->shards = shards;
+	map->nshards = nshards;
+	map->keyspace = keyspace;
+	map->hashed = hashed;
+}
+
+static __inline__ struct avl_shard *avl_sharded_shard(struct avl_sharded *map,
+						      uint16_t key)
+{
+	size_t shard;
+
+	if (map->hashed)
+		shard = key % map->nshards;
+	else
+		shard = (size_t)(((uint64_t)key * map->nshards) / map->keyspace);
+
+	return &map->shards[shard];
+}
+
+static __inline__ void avl_sharded_insert(struct avl_sharded *map,
+					  struct avlitem *new_entry)
+{
+	struct avl_shard *shard = avl_sharded_shard(map, new_entry->i);
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodep;
+	struct avlitem *cur_entry;
+
+	avl_shard_lock(shard);
+
+	cur_nodep = &shard->root.node;
+	while (*cur_nodep) {
+		cur_entry = avl_entry(*cur_nodep, struct avlitem, avl);
+
+		parent = *cur_nodep;
+		if (cmpint(&new_entry->i, &cur_entry->i) <= 0)
+			cur_nodep = &((*cur_nodep)->left);
+		else
+			cur_nodep = &((*cur_nodep)->right);
+	}
+
+	avl_insert(&new_entry->avl, parent, cur_nodep, &shard->root);
+
+	avl_shard_unlock(shard);
+}
+
+static __inline__ struct avlitem *avl_sharded_find(struct avl_sharded *map,
+						   uint16_t x)
+{
+	struct avl_shard *shard = avl_sharded_shard(map, x);
+	struct avlitem *found = NULL;
+	struct avlitem *cur_entry;
+	struct avl_node *node;
+	int res;
+
+	avl_shard_lock(shard);
+
+	node = shard->root.node;
+	while (node) {
+		cur_entry = avl_entry(node, struct avlitem, avl);
+
+		res = cmpint(&x, &cur_entry->i);
+		if (res == 0) {
+			found = cur_entry;
+			break;
+		}
+
+		if (res < 0)
+			node = node->left;
+		else
+			node = node->right;
+	}
+
+	avl_shard_unlock(shard);
+
+	return found;
+}
+
+static __inline__ void avl_sharded_erase(struct avl_sharded *map,
+					 struct avlitem *entry)
+{
+	struct avl_shard *shard = avl_sharded_shard(map, entry->i);
+
+	avl_shard_lock(shard);
+	avl_erase(&entry->avl, &shard->root);
+	avl_shard_unlock(shard);
+}
+
+/* the iteration over all shards requires that all shards are locked */
+static __inline__ void avl_sharded_lock_all(struct avl_sharded *map)
+{
+	size_t i;
+
+	for (i = 0; i < map->nshards; i++)
+		avl_shard_lock(&map->shards[i]);
+}
+
+static __inline__ void avl_sharded_unlock_all(struct avl_sharded *map)
+{
+	size_t i;
+
+	for (i = map->nshards; i > 0; i--)
+		avl_shard_unlock(&map->shards[i - 1]);
+}
+
+static __inline__ bool avl_sharded_cursor_less(struct avl_node *a,
+						struct avl_node *b)
+{
+	struct avlitem *entry_a = avl_entry(a, struct avlitem, avl);
+	struct avlitem *entry_b = avl_entry(b, struct avlitem, avl);
+
+	return cmpint(&entry_a->i, &entry_b->i) < 0;
+}
+
+static __inline__ void avl_sharded_heap_down(struct avl_sharded_iter *iter,
+					     size_t pos)
+{
+	struct avl_node **heap = iter->cursors;
+	struct avl_node *tmp;
+	size_t child;
+
+	while ((child = 2 * pos + 1) < iter->heap_size) {
+		if (child + 1 < iter->heap_size &&
+		    avl_sharded_cursor_less(heap[child + 1], heap[child]))
+			child++;
+
+		if (!avl_sharded_cursor_less(heap[child], heap[pos]))
+			break;
+
+		tmp = heap[pos];
+		heap[pos] = heap[child];
+		heap[child] = tmp;
+		pos = child;
+	}
+}
+
+static __inline__ void avl_sharded_heap_init(struct avl_sharded_iter *iter)
+{
+	size_t i;
+
+	iter->heap_size = 0;
+	for (i = 0; i < iter->map->nshards; i++) {
+		if (!iter->cursors[i])
+			continue;
+
+		iter->cursors[iter->heap_size++] = iter->cursors[i];
+	}
+
+	for (i = iter->heap_size / 2; i > 0; i--)
+		avl_sharded_heap_down(iter, i - 1);
+}
+
+static __inline__ struct avl_node *
+avl_sharded_iter_merge(struct avl_sharded_iter *iter)
+{
+	struct avl_node *node;
+	struct avl_node *next;
+
+	if (!iter->heap_size)
+		return NULL;
+
+	node = iter->cursors[0];
+	next = avl_next(node);
+	if (next)
+		iter->cursors[0] = next;
+	else
+		iter->cursors[0] = iter->cursors[--iter->heap_size];
+
+	avl_sharded_heap_down(iter, 0);
+
+	return node;
+}
+
+static __inline__ struct avl_node *
+avl_sharded_iter_concat(struct avl_sharded_iter *iter)
+{
+	struct avl_node *node;
+
+	for (; iter->shard < iter->map->nshards; iter->shard++) {
+		node = iter->cursors[iter->shard];
+		if (!node)
+			continue;
+
+		iter->cursors[iter->shard] = avl_next(node);
+		return node;
+	}
+
+	return NULL;
+}
+
+/* cursors must have space for nshards nodes */
+static __inline__ struct avl_node *
+avl_sharded_first(struct avl_sharded *map, struct avl_sharded_iter *iter,
+		  struct avl_node **cursors)
+{
+	size_t i;
+
+	iter->map = map;
+	iter->cursors = cursors;
+	iter->shard = 0;
+	iter->heap_size = 0;
+
+	for (i = 0; i < map->nshards; i++)
+		cursors[i] = avl_first(&map->shards[i].root);
+
+	if (map->hashed) {
+		avl_sharded_heap_init(iter);
+		return avl_sharded_iter_merge(iter);
+	} else {
+		return avl_sharded_iter_concat(iter);
+	}
+}
+
+static __inline__ struct avl_node *
+avl_sharded_next(struct avl_sharded_iter *iter)
+{
+	if (iter->map->hashed)
+		return avl_sharded_iter_merge(iter);
+	else
+		return avl_sharded_iter_concat(iter);
+}
+
+#endif /* __AVLTREE_COMMON_SHARDED_H__ */
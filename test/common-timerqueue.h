@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: MIT */
+/* Minimal AVL-tree helper functions test
+ *
+ * SPDX-FileCopyrightText: Sven Eckelmann <sven@narfation.org>
+ */
+
+#ifndef __AVLTREE_COMMON_TIMERQUEUE_H__
+#define __AVLTREE_COMMON_TIMERQUEUE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../avltree.h"
+#include "common.h"
+
+/* pending is only true while the timer is queued. Expired and deleted
+ * timers can be added or rearmed again
+ */
+struct avl_timer {
+	uint64_t expires;
+	struct avl_node avl;
+	struct avl_timer *next_expired;
+	bool pending;
+};
+
+/* the earliest timer is cached and can be peeked in O(1). Per-CPU timer
+ * queues are just one avl_timerqueue per CPU
+ */
+struct avl_timerqueue {
+	struct avl_root root;
+	struct avl_node *first;
+};
+
+static __inline__ int avl_timer_cmp(const struct avl_node *a,
+				    const struct avl_node *b)
+{
+	const struct avl_timer *timer_a = avl_entry(a, const struct avl_timer,
+						    avl);
+	const struct avl_timer *timer_b = avl_entry(b, const struct avl_timer,
+						    avl);
+
+	if (timer_a->expires < timer_b->expires)
+		return -1;
+
+	if (timer_a->expires > timer_b->expires)
+		return 1;
+
+	return 0;
+}
+
+static __inline__ uint64_t avl_timer_expires(const struct avl_node *node)
+{
+	return avl_entry(node, const struct avl_timer, avl)->expires;
+}
+
+static __inline__ void avl_timer_init(struct avl_timer *timer)
+{
+	timer->pending = false;
+}
+
+static __inline__ void avl_timerqueue_init(struct avl_timerqueue *queue)
+{
+	INIT_AVL_ROOT(&queue->root);
+	queue->first = NULL;
+}
+
+static __inline__ struct avl_timer *
+avl_timerqueue_peek(const struct avl_timerqueue *queue)
+{
+	if (!queue->first)
+		return NULL;
+
+	return avl_entry(queue->first, struct avl_timer, avl);
+}
+
+/* timers with equal expiry time are added after the existing ones */
+static __inline__ void avl_timerqueue_add(struct avl_timerqueue *queue,
+					  struct avl_timer *timer)
+{
+	struct avl_node *parent = NULL;
+	struct avl_node **cur_nodep = &queue->root.node;
+	bool isfirst = true;
+
+	while (*cur_nodep) {
+		parent = *cur_nodep;
+		if (avl_timer_cmp(&timer->avl, parent) < 0) {
+			cur_nodep = &((*cur_nodep)->left);
+		} else {
+			cur_nodep = &((*cur_nodep)->right);
+			isfirst = false;
+		}
+	}
+
+	if (isfirst)
+		queue->first = &timer->avl;
+
+	avl_insert(&timer->avl, parent, cur_nodep, &queue->root);
+	timer->pending = true;
+}
+
+static __inline__ void avl_timerqueue_del(struct avl_timerqueue *queue,
+					  struct avl_timer *timer)
+{
+	if (!timer->pending)
+		return;
+
+	if (queue->first == &timer->avl)
+		queue->first = avl_next(&timer->avl);
+
+	avl_erase(&timer->avl, &queue->root);
+	timer->pending = false;
+}
+
+/* a pending timer is only moved in the tree when the new expiry time changes
+ * its position. Only the neighbor in the direction of the change has to be
+ * checked for that. Timers which are not pending (e.g. periodic timers
+ * rearmed in their expiry function) are added again
+ */
+static __inline__ void avl_timerqueue_rearm(struct avl_timerqueue *queue,
+					    struct avl_timer *timer,
+					    uint64_t expires)
+{
+	struct avl_node *neighbor;
+	bool keep;
+
+	if (timer->pending) {
+		if (expires >= timer->expires) {
+			neighbor = avl_next(&timer->avl);
+			keep = !neighbor ||
+			       expires <= avl_timer_expires(neighbor);
+		} else {
+			neighbor = avl_prev(&timer->avl);
+			keep = !neighbor ||
+			       avl_timer_expires(neighbor) <= expires;
+		}
+
+		if (keep) {
+			timer->expires = expires;
+			return;
+		}
+
+		avl_timerqueue_del(queue, timer);
+	}
+
+	timer->expires = expires;
+	avl_timerqueue_add(queue, timer);
+}
+
+/* all timers due at @now are removed at once and then handed to @fn in
+ * expiry order. @fn can add or rearm timers again
+ */
+static __inline__ size_t
+avl_timerqueue_expire(struct avl_timerqueue *queue, uint64_t now,
+		      void (*fn)(struct avl_timer *timer))
+{
+	struct avl_timer **tail;
+	struct avl_timer *expired;
+	struct avl_timer *timer;
+	struct avl_node *last = NULL;
+	struct avl_node *node;
+	size_t cnt = 0;
+
+	tail = &expired;
+	for (node = queue->first; node; node = avl_next(node)) {
+		timer = avl_entry(node, struct avl_timer, avl);
+		if (timer->expires > now)
+			break;
+
+		*tail = timer;
+		tail = &timer->next_expired;
+		timer->pending = false;
+		last = node;
+		cnt++;
+	}
+	*tail = NULL;
+
+	if (!last)
+		return 0;
+
+	avl_erase_range(&queue->root, queue->first, last, NULL);
+	queue->first = node;
+
+	while (expired) {
+		timer = expired;
+		expired = timer->next_expired;
+		fn(timer);
+	}
+
+	return cnt;
+}
+
+#endif /* __AVLTREE_COMMON_TIMERQUEUE_H__ */
@@ -13,6 +13,15 @@
 #include "../avltree.h"
 #include "common.h"
 
+static __inline__ int avlitem_cmp(const struct avl_node *a,
+				  const struct avl_node *b)
+{
+	const struct avlitem *item_a = avl_entry(a, const struct avlitem, avl);
+	const struct avlitem *item_b = avl_entry(b, const struct avlitem, avl);
+
+	return cmpint(&item_a->i, &item_b->i);
+}
+
 static __inline__ void avlitem_insert_unbalanced(struct avl_root *root,
 						 struct avlitem *new_entry)
 {
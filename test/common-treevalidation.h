@@ -52,6 +52,37 @@ static __inline__ void check_root_order(const struct avl_root *root,
 	assert(size == pos);
 }
 
+#ifdef AVLTREE_WAVL
+static __inline__ size_t check_depth_node(const struct avl_node *node)
+{
+	size_t rank_left;
+	size_t rank_right;
+	size_t rank;
+
+	if (!node)
+		return 0;
+
+	rank_left = check_depth_node(node->left);
+	rank_right = check_depth_node(node->right);
+
+	/* rank + 1 of the node derived from both children */
+	if (avl_balance(node) & AVL_RIGHT)
+		rank = rank_left + 2;
+	else
+		rank = rank_left + 1;
+
+	if (avl_balance(node) & AVL_LEFT)
+		assert(rank == rank_right + 2);
+	else
+		assert(rank == rank_right + 1);
+
+	/* leafs must have rank 0 */
+	if (!node->left && !node->right)
+		assert(avl_balance(node) == AVL_NEUTRAL);
+
+	return rank;
+}
+#else
 static __inline__ size_t check_depth_node(const struct avl_node *node)
 {
 	size_t depth_left;
@@ -86,6 +117,7 @@ static __inline__ size_t check_depth_node(const struct avl_node *node)
 
 	return depth_max + 1;
 }
+#endif
 
 static __inline__ void check_depth(const struct avl_root *root)
 {